@@ -0,0 +1,69 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Non-blocking HD44780 driver, 4-bit mode.
+*                     Commands and characters are queued and service()
+*                     sends a bounded number of them on each loop() pass,
+*                     so the display never holds up serial or encoder
+*                     handling. Only begin() and createChar_P() wait.
+*
+*/
+
+#ifndef ASYNC_LCD_H
+#define ASYNC_LCD_H
+
+#include <Arduino.h>
+
+class AsyncLcd : public Print {
+public:
+  static const uint8_t kQueueSize = 64;     // Bytes (commands + characters) waiting to be sent
+
+  // Pin configuration: RS, E, D4, D5, D6, D7
+  AsyncLcd(uint8_t rs, uint8_t en, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7);
+
+  // Blocking controller initialization. Call once from setup(). The line length does not
+  // change the HD44780 setup, cols is there for the LiquidCrystal signature.
+  void begin(uint8_t cols, uint8_t rows);
+  // Load a custom glyph from flash (PROGMEM) into CGRAM slot 0..7. Waits for queue room,
+  // call from setup().
+  void createChar_P(uint8_t location, const uint8_t charmap[8]);
+
+  // Queued operations. They return without touching the bus.
+  void clear();
+  void cursor();
+  void noCursor();
+  void setCursor(uint8_t col, uint8_t row);
+  void command(uint8_t value);
+  virtual size_t write(uint8_t value);
+  using Print::write;
+
+  // Send up to maxBytes queued bytes, as far as the controller is ready for them.
+  // Returns the number of bytes sent.
+  uint8_t service(uint8_t maxBytes);
+
+  uint8_t room() const { return kQueueSize - count; }    // Free queue entries
+  uint8_t pending() const { return count; }              // Queued entries not sent yet
+
+private:
+  bool push(uint8_t value, bool isData);
+  void waitRoom(uint8_t entries);
+  void send(uint8_t value, bool isData);
+  void write4bits(uint8_t value);
+  void pulseEnable();
+
+  uint8_t rsPin;
+  uint8_t enPin;
+  uint8_t dataPins[4];
+  uint8_t displayControl;
+
+  // Ring buffer. The RS line of each entry is kept as one bit in isData.
+  uint8_t queue[kQueueSize];
+  uint8_t isData[kQueueSize / 8];
+  uint8_t head;
+  uint8_t count;
+
+  unsigned long readyAt;      // micros() when the controller accepts the next byte
+};
+
+#endif
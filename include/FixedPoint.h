@@ -0,0 +1,25 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Fixed-point helpers. Radio values are kept as
+*                     scaled integers (Khz, 0.1 Khz) so no float
+*                     parsing or printing code is needed.
+*
+*/
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <Arduino.h>
+
+// Parse a decimal string ("118.025", "350.5", "7000") into an integer scaled
+// by 10^decimals. Extra fraction digits are rounded, missing ones are zero.
+// Parsing stops at the first character that is not a digit or the point.
+long parseFixed(const char* s, uint8_t decimals);
+
+// Print value / 10^decimals right aligned in a field of width characters.
+// pad fills the left side, use '0' for leading zeros.
+void printFixed(Print& out, long value, uint8_t width, uint8_t decimals, char pad = ' ');
+
+#endif
@@ -0,0 +1,101 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : 2x16 shadow framebuffer for the HD44780 display.
+*                     The screen is rendered into RAM and flush() only
+*                     sends the cells that differ from what the panel
+*                     already shows.
+*
+*/
+
+#ifndef LCD_FRAME_BUFFER_H
+#define LCD_FRAME_BUFFER_H
+
+#include <Arduino.h>
+
+class LcdFrameBuffer : public Print {
+public:
+  static const uint8_t kCols = 16;
+  static const uint8_t kRows = 2;
+
+  LcdFrameBuffer();
+
+  // Blank the back buffer and move the write position home
+  void clear();
+  // Write position. Where it is left after rendering is the visible cursor.
+  void setCursor(uint8_t col, uint8_t row);
+  // Panel content unknown (cleared or garbled): resend every cell on next flush
+  void invalidate();
+
+  virtual size_t write(uint8_t c);
+  using Print::write;
+
+  // Queue the changed cells on the display, as far as its queue has room.
+  // Returns true when the panel is up to date, false if flush() has to be
+  // called again to send the rest.
+  template <class Display>
+  bool flush(Display& display);
+
+private:
+  char back[kRows][kCols];      // What the screen code rendered
+  char shown[kRows][kCols];     // What the panel shows
+  uint8_t col;                  // Current write position
+  uint8_t row;
+  uint8_t shownCol;             // Visible cursor position on the panel
+  uint8_t shownRow;
+  bool stale;                   // Panel content unknown
+};
+
+// ------------------------------------ Flush --------------------------------------
+
+template <class Display>
+bool LcdFrameBuffer::flush(Display& display) {
+  if (stale) {
+    // Make every shown cell differ from the back buffer so all of them get sent
+    for (uint8_t r = 0; r < kRows; r++) {
+      for (uint8_t c = 0; c < kCols; c++) {
+        shown[r][c] = ~back[r][c];
+      }
+    }
+    stale = false;
+  }
+
+  uint8_t sent = 0;
+  for (uint8_t r = 0; r < kRows; r++) {
+    // The HD44780 address counter advances after each write, so a run of
+    // changed cells only needs one cursor move. Rows do not wrap into each other.
+    bool inRun = false;
+    for (uint8_t c = 0; c < kCols; c++) {
+      if (back[r][c] == shown[r][c]) {
+        inRun = false;
+        continue;
+      }
+      // Room for a cursor move, the character and the final cursor placement.
+      // Cells left unsent still differ from shown[] and go out on the next call.
+      // Nothing else is queued here: a cursor move per call would eat the room
+      // the display freed and the frame would never complete.
+      if (display.room() < (inRun ? 2 : 3)) {
+        return false;
+      }
+      if (!inRun) {
+        display.setCursor(c, r);
+        inRun = true;
+      }
+      display.write((uint8_t)back[r][c]);
+      shown[r][c] = back[r][c];
+      sent++;
+    }
+  }
+
+  // --- Cursor ---
+  // Any write moved the panel cursor, so it has to be put back.
+  if (sent > 0 || col != shownCol || row != shownRow) {
+    display.setCursor(col, row);
+    shownCol = col;
+    shownRow = row;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Interrupt driven quadrature decoder. Both encoder
+*                     pins interrupt on change, a transition table
+*                     decodes the quarter steps and every detent is put
+*                     into a ring with the micros() time it happened,
+*                     so loop() gets exact step timing however late it
+*                     gets to read them.
+*
+*/
+
+#ifndef QUAD_DECODER_H
+#define QUAD_DECODER_H
+
+#include <Arduino.h>
+
+struct EncoderStep {
+  unsigned long us;             // micros() at the detent edge
+  int8_t dir;                   // +1 / -1
+};
+
+class QuadDecoder {
+public:
+  static const uint8_t kRingSize = 8;   // Power of two, more detents than a fast spin makes between two reads
+  static const uint8_t kMaxDecoders = 4;  // Instances that get interrupt handlers
+
+  // a / b must be interrupt pins (2 and 3 on the UNO, 2, 3, 18 - 21 on the Mega)
+  QuadDecoder(uint8_t a, uint8_t b);
+  // Attach the interrupts. Returns false when kMaxDecoders decoders are running already.
+  bool begin();
+
+  // loop() side: take the oldest step. Returns false when there is none.
+  bool read(EncoderStep& step);
+  // Steps dropped because loop() did not read the ring in time
+  uint16_t overflows();
+
+private:
+  // attachInterrupt() takes a plain function: one handler per slot, each decodes its instance
+  template <uint8_t slot> static void onPinChange();
+  static void (* const handlers[kMaxDecoders])();
+  static QuadDecoder* instances[kMaxDecoders];
+  static uint8_t instanceCount;
+  void decode();
+
+  uint8_t pinA;
+  uint8_t pinB;
+  uint8_t state;                // Last pin levels, bit 0 = A, bit 1 = B
+  int8_t quarters;              // Quarter steps since the last detent
+
+  // Single producer (ISR) / single consumer (loop) ring: only the ISR writes head,
+  // only loop() writes tail, and one byte indexes are atomic on the AVR. A compiler
+  // barrier orders the entry against the index, see compilerBarrier().
+  EncoderStep ring[kRingSize];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  volatile uint16_t overflowCount;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Free RAM and stack high-water mark. At boot the
+*                     RAM between the heap and the stack is painted
+*                     with a pattern; how much of it is still intact
+*                     later is the least free RAM there has been, the
+*                     deepest call chain and interrupt included.
+*                     Only on the AVR, the native build reports
+*                     kRamUnknown.
+*
+*/
+
+#ifndef RAM_MONITOR_H
+#define RAM_MONITOR_H
+
+#include <Arduino.h>
+
+static const uint16_t kRamUnknown = 0xFFFF;
+
+// Paint the free RAM below the stack pointer. Call first in setup().
+void paintRam();
+// Bytes between the end of the heap and the stack pointer now
+uint16_t freeRam();
+// Painted bytes never written since paintRam(): the free RAM left at the deepest point
+uint16_t ramHeadroom();
+
+#endif
@@ -0,0 +1,50 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Cooperative scheduler for loop(). Every task is
+*                     a short piece of work with a time budget, run in
+*                     priority order. The first task is the urgent one
+*                     (the encoders): it starts every pass and runs
+*                     again between the others once boundUs passed, so
+*                     it waits at most boundUs plus one run of another
+*                     task. Runs over budget are counted per task.
+*
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+struct Task {
+  const char* name;             // PROGMEM, for the STATS report
+  void (*run)();
+  uint16_t budgetUs;            // Longest a run should take
+  uint16_t runs;                // Since resetStats(), saturating
+  uint16_t overruns;            // Runs longer than budgetUs
+  uint16_t longest;             // us, saturating
+};
+
+class Scheduler {
+public:
+  // taskList[0] is the urgent task, bound in us
+  Scheduler(Task* taskList, uint8_t taskCount, uint16_t bound);
+
+  // One pass over all the tasks, call from loop()
+  void run();
+  void resetStats();
+
+  uint8_t size() const { return count; }
+  const Task& task(uint8_t i) const { return tasks[i]; }
+
+private:
+  void runTask(Task& task);
+
+  Task* tasks;
+  uint8_t count;
+  uint16_t boundUs;
+  unsigned long urgentUs;       // micros() when the urgent task last finished
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Outbound frame queue for the serial port.
+*                     CmdMessenger writes into a ring instead of the
+*                     port, service() moves as many bytes as the UART
+*                     takes without waiting. Frames end on an unescaped
+*                     ';'. Two lanes: urgent frames (urgentNext) go
+*                     ahead of every normal frame not started yet.
+*                     A frame can replace a queued one with the
+*                     same command and first fields (mergeNext), or be
+*                     dropped when there is no room (dropNext). Frames
+*                     that must go out are written once room() has
+*                     kMaxFrame bytes, the writer defers them until
+*                     then. One that still finds the queue full waits
+*                     like a plain write, which is counted as a stall.
+*                     Framed (a fast rate was negotiated, see
+*                     setFraming): each frame goes out with a sequence
+*                     number and a CRC8 before its ';', two hex digits
+*                     each. Received frames are held until their ';',
+*                     only good ones are read, bad and missing ones
+*                     are counted. Else reads pass through.
+*
+*/
+
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <Arduino.h>
+
+// Queue bytes, can be set from the build flags
+#ifndef SERIAL_LINK_QUEUE
+#define SERIAL_LINK_QUEUE 96
+#endif
+
+// Framed fast link, see setFraming(). Left out on the UNO, where its receive buffer does not
+// fit next to CmdMessenger's; can be set from the build flags.
+#ifndef SERIAL_LINK_FRAMING
+#if defined(__AVR_ATmega328P__)
+#define SERIAL_LINK_FRAMING 0
+#else
+#define SERIAL_LINK_FRAMING 1
+#endif
+#endif
+
+class SerialLink : public Stream {
+public:
+  static const uint16_t kQueueSize = SERIAL_LINK_QUEUE;
+  // Room to ask for before a frame that must not stall: the longest frame sent, the INIT
+  // answer (71 bytes)
+  static const uint8_t kMaxFrame = 72;
+  static const uint8_t kMaxReceived = 64;   // CmdMessenger's command buffer
+  static const uint8_t kTrailer = 4;        // Framed: sequence number and CRC8 before the ';'
+
+  // CmdMessenger's separators and escape character, the defaults are its own
+  SerialLink(Stream& port, char separator = ',', char end = ';', char esc = '/');
+
+  // Move queued frames to the port, as many bytes as it takes now. Returns the bytes moved.
+  uint16_t service();
+  uint16_t room() const { return kQueueSize - count; }
+  uint16_t pending() const { return count; }
+  uint16_t urgentPending() const { return urgent; }
+
+  // The next frame goes in the urgent lane: after the urgent frames queued before it and
+  // the frame on the wire, ahead of the normal ones
+  void urgentNext() { nextUrgent = true; }
+
+  // The next frame replaces a queued frame with the same text up to its last field
+  // (a SET event with a newer value), which is not sent then
+  void mergeNext() { nextMerges = true; }
+  // The next frame is dropped instead of waiting when the queue is full (log lines)
+  void dropNext() { nextDrops = true; }
+
+  // Trailer on the frames sent and checked on the frames received. Both sequence numbers
+  // start again from 0. A whole received frame not read yet is kept. Stays off without
+  // SERIAL_LINK_FRAMING.
+  void setFraming(bool on);
+  bool framing() const { return framed; }
+#if SERIAL_LINK_FRAMING
+  // Good frames received since framing went on
+  uint16_t framesIn() const { return goodFrames; }
+#else
+  uint16_t framesIn() const { return 0; }
+#endif
+
+  virtual int available();
+  virtual int peek();
+  virtual int read();
+  virtual size_t write(uint8_t c);
+  using Print::write;
+  virtual int availableForWrite() { return room(); }
+  // Wait until everything queued is on its way
+  virtual void flush();
+
+  // Counters, reset by resetStats()
+  uint16_t highWater;           // Most bytes queued
+  uint16_t merged;              // Frames replaced by a newer one
+  uint16_t dropped;             // dropNext() frames that found no room
+  uint16_t stalls;              // Frames that waited for room
+  uint16_t corrupt;             // Framed: received frames with a bad trailer or too long
+  uint16_t lost;                // Framed: received frames missing from the sequence, corrupt ones included
+  void resetStats();
+
+private:
+  // Queue index of the i-th byte from tail, no division on the AVR
+  uint16_t index(uint16_t i) const { i += tail; return i >= kQueueSize ? i - kQueueSize : i; }
+  uint8_t at(uint16_t i) const { return queue[index(i)]; }
+  uint8_t sendOne();
+  void sendTrailer();
+#if SERIAL_LINK_FRAMING
+  bool held();
+  void receive();
+  void accept();
+#endif
+  void endFrame();
+  void merge();
+  void promote();
+  void remove(uint16_t from, uint16_t length);
+  void reverse(uint16_t from, uint16_t to);
+
+  Stream& stream;
+  char fieldSeparator;
+  char frameEnd;
+  char escape;
+
+  uint8_t queue[kQueueSize];
+  uint16_t tail;                // Oldest byte
+  uint16_t count;               // Bytes queued, the frame being written included
+  uint16_t open;                // Bytes of the frame being written, at the end
+  uint16_t urgent;              // Bytes from tail in the urgent lane
+  bool writeEscaped;            // Last byte written was an unescaped escape
+  bool sendEscaped;             // Same for the last byte sent
+  bool sendMidFrame;            // The oldest frame is partly sent
+  bool nextMerges;
+  bool nextUrgent;
+  bool nextDrops;
+  bool dropping;                // Skipping the rest of a dropped frame
+  bool openSent;                // Part of the frame being written went out while it stalled
+  bool openStalled;             // The frame being written waited for room
+
+  bool framed;
+  uint8_t txSeq;                // Sequence number of the frame being sent
+  uint8_t txCrc;                // CRC8 of its bytes sent so far
+#if SERIAL_LINK_FRAMING
+  uint8_t rxSeq;                // Sequence number expected next
+  uint16_t goodFrames;
+  uint8_t rx[kMaxReceived + kTrailer];  // Received frame without its ';'
+  uint8_t rxLength;             // Bytes in rx, one more than it holds when the frame is too long
+  uint8_t rxRead;               // Next byte read from a good frame
+  bool rxReady;                 // rx holds a good frame, trailer replaced by the ';'
+  bool rxEscaped;
+#endif
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : User settings kept in EEPROM. Each save writes a
+*                     versioned record with a CRC into the next slot of
+*                     a ring, so the wear is spread over all the slots
+*                     and a torn write leaves the previous record valid.
+*                     A save is written one byte per service() call,
+*                     only when the EEPROM is idle, so loop() never
+*                     waits out the 3.3 ms cell writes.
+*
+*/
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+
+// Persistent settings. Changing this layout needs a new kVersion.
+struct Settings {
+  uint8_t brightness;
+  uint8_t contrast;
+  uint8_t displayMode;          // modeLCD
+};
+
+class SettingsStore {
+public:
+  static const uint8_t kVersion = 1;
+
+  // Ring of slotCount records starting at EEPROM address
+  SettingsStore(uint16_t address, uint8_t slotCount);
+
+  // Find the newest valid record. Returns false, leaving settings untouched,
+  // when there is none (blank EEPROM, other layout version).
+  bool load(Settings& settings);
+  // Queue settings for the slot after the newest record. Nothing is written when
+  // they equal the newest record. Saving again before service() is done restarts it.
+  void save(const Settings& settings);
+  // Write the next byte of a queued save if no cell write is in progress.
+  // Returns true while a save is still being written.
+  bool service();
+
+private:
+  struct Record {
+    uint8_t version;
+    uint8_t sequence;           // +1 per save, wraps
+    Settings settings;
+    uint8_t crc;                // CRC-8 of the bytes above, written last
+  };
+
+  uint16_t base;
+  uint8_t slots;
+  uint8_t newest;               // Slot of the newest record, slots if none
+  Record last;
+  Record pending;               // Being written into pendingSlot
+  uint8_t pendingSlot;
+  uint8_t written;              // Bytes of pending in EEPROM, sizeof(Record) when idle
+
+  bool readSlot(uint8_t slot, Record& record);
+  static uint8_t crc8(const uint8_t* data, uint8_t length);
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : SimConnect events sent through SPAD.neXt.
+*                     Names are stored once in PROGMEM and referred
+*                     to by a one byte id everywhere else.
+*
+*/
+
+#ifndef SIM_EVENTS_H
+#define SIM_EVENTS_H
+
+#include <Arduino.h>
+
+// To add an event, add a line here. The name is sent as "SIMCONNECT:<name>".
+#define SIM_EVENT_LIST(X)           \
+  X(COM_RADIO_FRACT_DEC_CARRY)      \
+  X(COM_RADIO_FRACT_INC_CARRY)      \
+  X(COM_RADIO_WHOLE_DEC)            \
+  X(COM_RADIO_WHOLE_INC)            \
+  X(NAV1_RADIO_FRACT_DEC)           \
+  X(NAV1_RADIO_FRACT_INC)           \
+  X(NAV1_RADIO_WHOLE_DEC)           \
+  X(NAV1_RADIO_WHOLE_INC)           \
+  X(COM2_RADIO_FRACT_DEC_CARRY)     \
+  X(COM2_RADIO_FRACT_INC_CARRY)     \
+  X(COM2_RADIO_WHOLE_DEC)           \
+  X(COM2_RADIO_WHOLE_INC)           \
+  X(NAV2_RADIO_FRACT_DEC)           \
+  X(NAV2_RADIO_FRACT_INC)           \
+  X(NAV2_RADIO_WHOLE_DEC)           \
+  X(NAV2_RADIO_WHOLE_INC)           \
+  X(ADF_FRACT_DEC_CARRY)            \
+  X(ADF_FRACT_INC_CARRY)            \
+  X(ADF_1_DEC)                      \
+  X(ADF_1_INC)                      \
+  X(ADF_10_DEC)                     \
+  X(ADF_10_INC)                     \
+  X(ADF_100_DEC)                    \
+  X(ADF_100_INC)                    \
+  X(ADF_CARD_DEC)                   \
+  X(ADF_CARD_INC)                   \
+  X(XPNDR_1_DEC)                    \
+  X(XPNDR_1_INC)                    \
+  X(XPNDR_10_DEC)                   \
+  X(XPNDR_10_INC)                   \
+  X(XPNDR_100_DEC)                  \
+  X(XPNDR_100_INC)                  \
+  X(XPNDR_1000_DEC)                 \
+  X(XPNDR_1000_INC)                 \
+  X(COM1_RADIO_SWAP)                \
+  X(NAV1_RADIO_SWAP)                \
+  X(COM2_RADIO_SWAP)                \
+  X(NAV2_RADIO_SWAP)                \
+  X(XPNDR_IDENT_ON)                 \
+  X(COM_STBY_RADIO_SET_HZ)          \
+  X(COM2_STBY_RADIO_SET_HZ)         \
+  X(NAV1_STBY_SET_HZ)               \
+  X(NAV2_STBY_SET_HZ)               \
+  X(ADF_COMPLETE_SET)               \
+  X(ADF_CARD_SET)                   \
+  X(XPNDR_SET)
+
+#define SIM_EVENT_ID(name) ev##name,
+
+enum SimEvent : uint8_t {
+  evNone = 0,
+  SIM_EVENT_LIST(SIM_EVENT_ID)
+  evCount
+};
+
+#undef SIM_EVENT_ID
+
+// Full event name ("SIMCONNECT:COM1_RADIO_SWAP") in flash, printable with F() semantics
+const __FlashStringHelper* simEventName(uint8_t event);
+
+#endif
@@ -0,0 +1,97 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Hot path instrumentation. Durations go into
+*                     log2 histograms (a bucket index is a bit count,
+*                     no division or sorting on the board) and the
+*                     serial traffic is counted by a Stream wrapper
+*                     placed between CmdMessenger and the port. The
+*                     same wrapper can cap the bytes CmdMessenger
+*                     reads per call, the rest waits in the RX buffer.
+*
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+
+// ------------------------------------ Histogram -----------------------------------
+
+// Bucket i counts durations of 2^(i-1) to 2^i - 1 microseconds, bucket 0 is 0 us.
+// The last bucket also takes everything longer. Buckets are one byte: when one is full all
+// are halved, the percentiles only need the shape.
+class LatencyHistogram {
+public:
+  static const uint8_t kBuckets = 17;   // Up to 65 ms
+
+  LatencyHistogram();
+  void add(unsigned long us);
+  void reset();
+
+  uint16_t samples() const { return total; }
+  unsigned long maximum() const { return longest; }
+  // Upper bound of the bucket holding the given percentile, capped at the maximum
+  unsigned long percentile(uint8_t p) const;
+
+private:
+  uint8_t count[kBuckets];
+  uint16_t total;               // Samples, saturating
+  unsigned long longest;
+};
+
+// Times the enclosing scope into a histogram
+class ScopeTimer {
+public:
+  ScopeTimer(LatencyHistogram& timed) : histogram(timed), start(micros()) {}
+  ~ScopeTimer() { histogram.add(micros() - start); }
+private:
+  LatencyHistogram& histogram;
+  unsigned long start;
+};
+
+// ---------------------------------- Byte counter ----------------------------------
+
+// Passes everything through to the wrapped stream and counts the bytes
+class CountingStream : public Stream {
+public:
+  static const uint16_t kNoBudget = 0xFFFF;
+
+  CountingStream(Stream& counted) : bytesIn(0), bytesOut(0), stream(counted), readBudget(kNoBudget) {}
+
+  // Bytes that can be read before available() reports none, kNoBudget for no limit
+  void setReadBudget(uint16_t bytes) { readBudget = bytes; }
+
+  virtual int available() {
+    int n = stream.available();
+    return readBudget != kNoBudget && n > (int)readBudget ? readBudget : n;
+  }
+  virtual int peek() { return stream.peek(); }
+  virtual int read() {
+    int c = stream.read();
+    if (c >= 0) {
+      bytesIn++;
+      if (readBudget != kNoBudget && readBudget > 0) {
+        readBudget--;
+      }
+    }
+    return c;
+  }
+  virtual size_t write(uint8_t c) {
+    bytesOut++;
+    return stream.write(c);
+  }
+  using Print::write;
+  virtual int availableForWrite() { return stream.availableForWrite(); }
+  virtual void flush() { stream.flush(); }
+
+  unsigned long bytesIn;
+  unsigned long bytesOut;
+
+private:
+  Stream& stream;
+  uint16_t readBudget;
+};
+
+#endif
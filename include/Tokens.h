@@ -0,0 +1,37 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Keywords of the SPAD.neXt control messages.
+*                     Arguments are classified in place in the
+*                     CmdMessenger buffer: a switch on the length and
+*                     one character picks the only candidate, a single
+*                     compare against flash confirms it. No String,
+*                     no heap.
+*
+*/
+
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include <Arduino.h>
+
+enum Token : uint8_t {
+  tkUnknown = 0,
+  tkEND,
+  tkINIT,
+  tkPING,
+  tkMSFS,
+  tkALIAS,
+  tkSTART,
+  tkSTATS,
+  tkCONFIG,
+  tkBINARY,
+  tkBAUD,
+  tkPROVIDER
+};
+
+// tkUnknown for NULL, what readStringArg() returns past the last argument
+Token classifyToken(const char* s);
+
+#endif
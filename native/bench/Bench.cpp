@@ -0,0 +1,392 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Benchmark harness helpers for the native build.
+*
+*/
+
+#include <Arduino.h>
+#include <algorithm>
+#include <EncoderButton.h>
+#include "Hardware.h"
+#include "Bench.h"
+#include "Capture.h"
+
+namespace bench {
+
+Samples loopUs;
+
+// ---------------------------------- Statistics -------------------------------------
+
+uint32_t Samples::percentile(double p) const {
+  if (values.empty()) {
+    return 0;
+  }
+  std::vector<uint32_t> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  size_t i = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+double Samples::mean() const {
+  if (values.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (uint32_t v : values) {
+    sum += v;
+  }
+  return sum / values.size();
+}
+
+uint32_t Samples::max() const {
+  return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+}
+
+// ----------------------------------- Host side -------------------------------------
+
+static std::vector<Frame> frames;
+static std::string partial;
+static bool escaped = false;
+static std::map<int, std::string> aliases;
+static std::map<int, std::string> subscribed;
+
+// "1,SUBSCRIBE,<channel>,<variable>" / "1,UNSUBSCRIBE,<channel>,<variable>"
+static void learnSubscription(const std::string& text) {
+  if (text.compare(0, 12, "1,SUBSCRIBE,") == 0) {
+    size_t comma = text.find(',', 12);
+    if (comma != std::string::npos) {
+      subscribed[atoi(text.c_str() + 12)] = text.substr(comma + 1);
+    }
+  }
+  if (text.compare(0, 14, "1,UNSUBSCRIBE,") == 0) {
+    subscribed.erase(atoi(text.c_str() + 14));
+  }
+}
+
+const std::map<int, std::string>& subscriptions() {
+  return subscribed;
+}
+
+// "1,ALIAS,<id>,<name>"
+static void learnAlias(const std::string& text, std::map<int, std::string>& table) {
+  if (text.compare(0, 8, "1,ALIAS,") != 0) {
+    return;
+  }
+  size_t comma = text.find(',', 8);
+  if (comma != std::string::npos) {
+    table[atoi(text.c_str() + 8)] = text.substr(comma + 1);
+  }
+}
+
+static std::string decodeEvent(const std::string& text, const std::map<int, std::string>& table) {
+  if (text.compare(0, 2, "4,") == 0) {
+    return text.substr(2);
+  }
+  if (text.compare(0, 2, "9,") == 0) {
+    size_t comma = text.find(',', 2);
+    auto alias = table.find(atoi(text.c_str() + 2));
+    if (alias == table.end()) {
+      return "?" + text;
+    }
+    return alias->second + (comma == std::string::npos ? "" : text.substr(comma));
+  }
+  return "";
+}
+
+std::string simEvent(const Frame& frame) {
+  return decodeEvent(frame.text, aliases);
+}
+
+std::vector<std::string> simEvents(const std::vector<Frame>& sequence) {
+  std::map<int, std::string> table;
+  std::vector<std::string> events;
+  for (const Frame& f : sequence) {
+    learnAlias(f.text, table);
+    std::string event = decodeEvent(f.text, table);
+    if (!event.empty()) {
+      events.push_back(event);
+    }
+  }
+  return events;
+}
+
+// --- Host port ---
+
+LinkCounters hostLink;
+static unsigned long portBaud = 0;
+static bool portFramed = false;
+static uint8_t sendSeq = 0;
+static uint8_t receiveSeq = 0;
+
+// CRC-8, polynomial 0x07, bit by bit: checks the table driven one of the board
+static uint8_t crc8(const std::string& bytes) {
+  uint8_t crc = 0;
+  for (unsigned char c : bytes) {
+    crc ^= c;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x80 ? (uint8_t)(crc << 1 ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static std::string hex(uint8_t v) {
+  char text[3];
+  snprintf(text, sizeof(text), "%02X", v);
+  return text;
+}
+
+// Each command with its trailer
+static std::string framed(const std::string& commands) {
+  std::string out;
+  std::string command;
+  bool escapedIn = false;
+  for (char c : commands) {
+    if (c == ';' && !escapedIn) {
+      command += hex(sendSeq++);
+      out += command + hex(crc8(command)) + ";";
+      command.clear();
+    } else {
+      command += c;
+    }
+    escapedIn = !escapedIn && c == '/';
+  }
+  return out + command;
+}
+
+// Frame text without its trailer, false when the trailer is wrong
+static bool unframed(std::string& text) {
+  if (text.size() <= 4) {
+    return false;
+  }
+  size_t payload = text.size() - 4;
+  char* end = nullptr;
+  std::string digits = text.substr(payload, 2);
+  long seq = strtol(digits.c_str(), &end, 16);
+  if (end != digits.c_str() + 2 || text.substr(payload + 2) != hex(crc8(text.substr(0, payload + 2)))) {
+    return false;
+  }
+  hostLink.lost += (uint8_t)(seq - receiveSeq);
+  receiveSeq = (uint8_t)(seq + 1);
+  text.resize(payload);
+  return true;
+}
+
+void setHostLink(unsigned long baud, bool framed) {
+  if (recording) {
+    recording->add(hw::now(), 'B', std::to_string(baud) + " " + (framed ? "1" : "0"));
+  }
+  portBaud = baud;
+  portFramed = framed;
+  sendSeq = 0;
+  receiveSeq = 0;
+}
+
+unsigned long hostBaud() {
+  return portBaud;
+}
+
+void setNoise(uint32_t everyBytes) {
+  if (recording) {
+    recording->add(hw::now(), 'N', std::to_string(everyBytes));
+  }
+  hw::uart.noiseEvery = everyBytes;
+  hw::uart.noiseInCount = 0;
+  hw::uart.noiseOutCount = 0;
+}
+
+void hostSend(const std::string& command) {
+  hostSendAt(command, hw::now());
+}
+
+void hostSendAt(const std::string& command, uint64_t at) {
+  std::string bytes = portFramed ? framed(command) : command;
+  if (recording) {
+    recording->add(at, '<', bytes);
+  }
+  hw::uart.hostSend(bytes, at, portBaud);
+}
+
+std::string binaryValues(const std::vector<std::pair<int, long>>& values) {
+  // The board drops commands of MESSENGERBUFFERSIZE - 1 bytes or more, escapes included
+  const size_t limit = 62;
+  std::string out;
+  std::string command = "22";
+  for (const auto& v : values) {
+    uint32_t packed = (uint32_t)v.first << 24 | ((uint32_t)v.second & 0xFFFFFF);
+    std::string arg = ",";
+    for (int i = 0; i < 4; i++) {
+      char c = (char)(packed >> (8 * i));
+      if (c == ',' || c == ';' || c == '/' || c == '\0') {
+        arg += '/';
+      }
+      arg += c;
+    }
+    if (command.size() + arg.size() > limit) {
+      out += command + ";";
+      command = "22";
+    }
+    command += arg;
+  }
+  if (command.size() > 2) {
+    out += command + ";";
+  }
+  return out;
+}
+
+std::vector<Frame>& framesOut() {
+  return frames;
+}
+
+size_t collectFrames() {
+  size_t before = frames.size();
+  while (!hw::uart.txLog.empty() && hw::uart.txLog.front().time <= hw::now()) {
+    hw::WireByte b = hw::uart.txLog.front();
+    hw::uart.txLog.pop_front();
+    if (portBaud && b.baud != portBaud) {
+      b.value = 0xFF;
+    }
+    if (b.value == ';' && !escaped) {
+      escaped = false;
+      if (portFramed && !unframed(partial)) {
+        hostLink.corrupt++;
+        partial.clear();
+        continue;
+      }
+      frames.push_back(Frame{b.time, partial});
+      if (recording) {
+        recording->add(b.time, '>', partial + ";");
+      }
+      learnAlias(partial, aliases);
+      learnSubscription(partial);
+      partial.clear();
+    } else if (b.value != '\r' && b.value != '\n') {
+      partial += (char)b.value;
+    }
+    escaped = !escaped && b.value == '/';
+  }
+  return frames.size() - before;
+}
+
+static void edge(uint64_t at, uint8_t pin, uint8_t level) {
+  if (recording) {
+    recording->add(at, 'P', std::to_string(pin) + " " + std::to_string(level));
+  }
+  hw::scheduleInput(at, pin, level);
+}
+
+uint64_t turn(int detents, uint64_t at, uint32_t periodUs) {
+  // Clockwise: B falls, A falls, B rises, A rises
+  const uint8_t pinA = 2, pinB = 3;
+  uint8_t first = detents > 0 ? pinB : pinA;
+  uint8_t second = detents > 0 ? pinA : pinB;
+  uint64_t t = at;
+  for (int i = 0; i < abs(detents); i++) {
+    edge(t, first, LOW);
+    edge(t + periodUs / 4, second, LOW);
+    edge(t + periodUs / 2, first, HIGH);
+    edge(t + periodUs * 3 / 4, second, HIGH);
+    t += periodUs;
+  }
+  return t - periodUs / 4;
+}
+
+void click(uint8_t count) {
+  if (recording) {
+    recording->add(hw::now(), 'C', std::to_string(count));
+  }
+  EncoderButton::first->simulateClicks(count);
+}
+
+void longPress() {
+  if (recording) {
+    recording->add(hw::now(), 'L', "");
+  }
+  EncoderButton::first->simulateLongPress();
+}
+
+void resetCounters() {
+  loopUs.values.clear();
+  frames.clear();
+  hw::lcd.bytes = 0;
+  hw::lcd.dataBytes = 0;
+  hw::lcd.violations = 0;
+  hw::uart.rxOverflows = 0;
+  hw::uart.bytesIn = 0;
+  hw::uart.bytesOut = 0;
+  hw::uart.txStallUs = 0;
+  hw::uart.noisyIn = 0;
+  hw::uart.noisyOut = 0;
+  hostLink = LinkCounters();
+  hw::eeprom.writes = 0;
+  hw::commandsDispatched = 0;
+}
+
+// ------------------------------------- Run -----------------------------------------
+
+void step() {
+  uint64_t t0 = hw::now();
+  hw::advance(hw::cost::loopBase);
+  loop();
+  loopUs.add((uint32_t)(hw::now() - t0));
+  collectFrames();
+}
+
+void runFor(uint64_t us, const std::function<void()>& each) {
+  uint64_t end = hw::now() + us;
+  while (hw::now() < end) {
+    if (each) {
+      each();
+    }
+    step();
+  }
+}
+
+uint64_t runUntil(const std::function<bool()>& done, uint64_t timeoutUs) {
+  uint64_t start = hw::now();
+  while (!done() && hw::now() - start < timeoutUs) {
+    step();
+  }
+  return hw::now() - start;
+}
+
+// ------------------------------------ Report ---------------------------------------
+
+void printHeader() {
+  printf("%-12s %8s %7s %7s %7s %8s %9s %9s %8s %6s %6s %9s\n",
+         "workload", "loops", "avg_us", "p50_us", "p99_us", "max_us",
+         "in_msg/s", "out_msg/s", "lcd_byte", "lcdviol", "rx_ovf", "txstall_us");
+}
+
+void report(const char* name, uint64_t startUs, uint64_t inMessages, uint64_t outMessages) {
+  double seconds = (hw::now() - startUs) / 1e6;
+  printf("%-12s %8zu %7.1f %7u %7u %8u %9.1f %9.1f %8u %6u %6u %9llu\n",
+         name, loopUs.count(), loopUs.mean(), loopUs.percentile(50), loopUs.percentile(99), loopUs.max(),
+         inMessages / seconds, outMessages / seconds, hw::lcd.bytes, hw::lcd.violations,
+         hw::uart.rxOverflows, (unsigned long long)hw::uart.txStallUs);
+  check(hw::uart.rxOverflows == 0, "no RX overflow");
+  check(hw::lcd.violations == 0, "no LCD timing violation");
+  check(hw::uart.txStallUs == 0, "no wait for the TX buffer");
+}
+
+void printScreen() {
+  printf("             |%s|\n             |%s|\n", hw::lcd.row(0).c_str(), hw::lcd.row(1).c_str());
+}
+
+static int failedChecks = 0;
+
+bool check(bool ok, const char* what) {
+  if (!ok) {
+    printf("             FAILED: %s\n", what);
+    failedChecks++;
+  }
+  return ok;
+}
+
+int checkFailures() {
+  return failedChecks;
+}
+
+}
@@ -0,0 +1,112 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Benchmark harness helpers for the native build.
+*                     Drives setup()/loop() on the virtual clock and
+*                     plays the SPAD.neXt side of the serial link.
+*
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <map>
+
+// Firmware entry points, src/main.cpp
+void setup();
+void loop();
+
+namespace bench {
+
+// ---------------------------------- Statistics -------------------------------------
+
+struct Samples {
+  std::vector<uint32_t> values;
+  void add(uint32_t v) { values.push_back(v); }
+  size_t count() const { return values.size(); }
+  uint32_t percentile(double p) const;
+  double mean() const;
+  uint32_t max() const;
+};
+
+// ----------------------------------- Host side -------------------------------------
+
+struct Frame {
+  uint64_t time;                // Last byte on the wire
+  std::string text;             // Without the ';'
+};
+
+// Send a command to the board at the given time (default: now)
+void hostSend(const std::string& command);
+void hostSendAt(const std::string& command, uint64_t at);
+// Values as kValues commands, "22,<v>,<v>,...;" with one CmdMessenger binary int32 per
+// value (data channel << 24 | fixed point value), as many per command as the board buffers
+std::string binaryValues(const std::vector<std::pair<int, long>>& values);
+// Host port: rate, 0 (the default) for whatever rate the board has, and the framed link
+// of SerialLink. Framed, hostSend() adds the sequence number and CRC8 to each command and
+// collectFrames() checks and strips them, frames that fail are counted and not kept.
+void setHostLink(unsigned long baud, bool framed);
+unsigned long hostBaud();
+struct LinkCounters {
+  uint32_t corrupt = 0;         // Bad trailer
+  uint32_t lost = 0;            // Missing from the sequence, corrupt ones included
+};
+extern LinkCounters hostLink;
+// Flip a bit of every n-th byte on the wire, both ways. 0: no noise.
+void setNoise(uint32_t everyBytes);
+// Outbound frames fully on the wire by now
+std::vector<Frame>& framesOut();
+// Collect TX bytes into frames, returns the number of new frames
+size_t collectFrames();
+
+// SPAD.neXt side of the event commands: learns the aliases the board registers and turns
+// "4,SIMCONNECT:<name>[,value]" or "9,<id>[,value]" into "SIMCONNECT:<name>[,value]".
+// Empty for any other frame.
+std::string simEvent(const Frame& frame);
+// Same for a recorded frame sequence, with the aliases registered in that sequence
+std::vector<std::string> simEvents(const std::vector<Frame>& frames);
+
+// Data channels the board is subscribed to, as channel -> SimConnect variable
+const std::map<int, std::string>& subscriptions();
+
+// Encoder on pins 2 (A) and 3 (B): schedule detents, one every periodUs from at,
+// negative for counter clockwise. Returns the time of the last edge.
+uint64_t turn(int detents, uint64_t at, uint32_t periodUs);
+// Button on the first EncoderButton, delivered on its next update()
+void click(uint8_t count);
+void longPress();
+
+// Zero the counters reported by report()
+void resetCounters();
+
+// ------------------------------------- Run -----------------------------------------
+
+// One loop() pass, its duration goes into loopUs
+void step();
+// Run loop() until the virtual clock has advanced by us. each() runs before every pass.
+void runFor(uint64_t us, const std::function<void()>& each = nullptr);
+// Run loop() until done() returns true or timeout, returns the time it took
+uint64_t runUntil(const std::function<bool()>& done, uint64_t timeoutUs);
+
+extern Samples loopUs;
+
+// ------------------------------------ Report ---------------------------------------
+
+void printHeader();
+// Workload line. Also checks that no RX byte was lost, the LCD timing was kept and no
+// frame waited for the TX buffer.
+void report(const char* name, uint64_t startUs, uint64_t inMessages, uint64_t outMessages);
+void printScreen();
+
+// A claim of the workload: printed when it does not hold, the process then exits with 1
+bool check(bool ok, const char* what);
+int checkFailures();
+
+}
+
+#endif
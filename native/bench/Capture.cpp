@@ -0,0 +1,100 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Serial session captures for the native build.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "Capture.h"
+
+namespace bench {
+
+Capture* recording = nullptr;
+
+static std::string escape(const std::string& bytes) {
+  std::string out;
+  char hex[5];
+  for (unsigned char c : bytes) {
+    if (c < 0x20 || c > 0x7E || c == '\\') {
+      snprintf(hex, sizeof(hex), "\\x%02X", c);
+      out += hex;
+    } else {
+      out += (char)c;
+    }
+  }
+  return out;
+}
+
+static std::string unescape(const std::string& text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\\' && i + 3 < text.size() && text[i + 1] == 'x') {
+      out += (char)strtol(text.substr(i + 2, 2).c_str(), nullptr, 16);
+      i += 3;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+void Capture::add(uint64_t time, char kind, const std::string& data) {
+  records.push_back(Record{time, kind, data});
+}
+
+bool Capture::save(const char* path) const {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  std::vector<Record> sorted(records);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Record& a, const Record& b) { return a.time < b.time; });
+  fprintf(f, "# OneKnobRadio serial capture: <t_us> <kind> <data>\n");
+  for (const Record& r : sorted) {
+    if (r.data.empty()) {
+      fprintf(f, "%llu %c\n", (unsigned long long)r.time, r.kind);
+    } else {
+      fprintf(f, "%llu %c %s\n", (unsigned long long)r.time, r.kind, escape(r.data).c_str());
+    }
+  }
+  return fclose(f) == 0;
+}
+
+bool Capture::load(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  records.clear();
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    std::string text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+      text.pop_back();
+    }
+    if (text.empty() || text[0] == '#') {
+      continue;
+    }
+    // "<t_us> <kind>[ <data>]"
+    size_t space = text.find(' ');
+    if (space == std::string::npos || space + 1 >= text.size()) {
+      continue;
+    }
+    Record r;
+    r.time = strtoull(text.c_str(), nullptr, 10);
+    r.kind = text[space + 1];
+    if (text.size() > space + 3) {
+      r.data = unescape(text.substr(space + 3));
+    }
+    records.push_back(r);
+  }
+  fclose(f);
+  return true;
+}
+
+}
@@ -0,0 +1,51 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Serial session captures for the native build.
+*                     A text file with one record per line, in time
+*                     order:
+*
+*                       <t_us> < <bytes>      host to board, handed to the UART at t
+*                       <t_us> > <frame;>     board to host, last byte on the wire at t
+*                       <t_us> P <pin> <lvl>  input pin change (encoder)
+*                       <t_us> C <count>      button clicks
+*                       <t_us> L              button long press
+*                       <t_us> B <baud> <0|1> host port rate and framing
+*                       <t_us> N <every>      wire noise, see setNoise()
+*
+*                     Bytes outside printable ASCII and '\' are written
+*                     as \xHH. Lines starting with '#' are comments.
+*
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct Record {
+  uint64_t time;
+  char kind;                    // '<', '>', 'P', 'C', 'L', 'B', 'N'
+  std::string data;             // Unescaped
+};
+
+struct Capture {
+  std::vector<Record> records;
+
+  void add(uint64_t time, char kind, const std::string& data);
+  // Written sorted by time. Records with the same time keep their order.
+  bool save(const char* path) const;
+  bool load(const char* path);
+};
+
+// Where the harness records to while a workload runs, null when not recording
+extern Capture* recording;
+
+}
+
+#endif
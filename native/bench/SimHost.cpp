@@ -0,0 +1,357 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : SPAD.neXt and simulator stand-in for the native
+*                     build.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Hardware.h"
+#include "Bench.h"
+#include "SimHost.h"
+
+namespace bench {
+
+static const char* const kPrefix = "SIMCONNECT:";
+static const uint64_t kPingUs = 1000000;
+static const uint64_t kIdentUs = 18000000;    // The sim ends IDENT by itself
+static const unsigned long kBaseBaud = 115200;
+static const uint64_t kSwitchUs = 5000;       // Board switching too, before the first framed command
+static const uint64_t kConfirmUs = 1000000;   // Longer than the board waits, it is back at 115200 then
+
+// Wrap v into [lo, hi)
+static long wrap(long v, long lo, long hi) {
+  long span = hi - lo;
+  v = (v - lo) % span;
+  return (v < 0 ? v + span : v) + lo;
+}
+
+static long fromBCD(long bcd) {
+  long v = 0;
+  for (long scale = 1; bcd > 0; bcd >>= 4, scale *= 10) {
+    v += (bcd & 0xF) * scale;
+  }
+  return v;
+}
+
+static bool startsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+SimHost::SimHost(uint32_t seed) : random(seed ? seed : 1) {
+  // Same cockpit as the scripted workloads
+  state["SIMCONNECT:ADF ACTIVE FREQUENCY:1"].value = 3505;
+  state["SIMCONNECT:COM ACTIVE FREQUENCY:1"].value = 118000;
+  state["SIMCONNECT:COM STANDBY FREQUENCY:1"].value = 121500;
+  state["SIMCONNECT:NAV ACTIVE FREQUENCY:1"].value = 110500;
+  state["SIMCONNECT:NAV STANDBY FREQUENCY:1"].value = 113900;
+  state["SIMCONNECT:COM ACTIVE FREQUENCY:2"].value = 124350;
+  state["SIMCONNECT:COM STANDBY FREQUENCY:2"].value = 127800;
+  state["SIMCONNECT:NAV ACTIVE FREQUENCY:2"].value = 108200;
+  state["SIMCONNECT:NAV STANDBY FREQUENCY:2"].value = 116700;
+  state["SIMCONNECT:ADF CARD"].value = 270;
+  state["SIMCONNECT:TRANSPONDER CODE:1"].value = 7000;
+  state["SIMCONNECT:TRANSPONDER IDENT"].value = 0;
+}
+
+void SimHost::start() {
+  linkBaud = kBaseBaud;
+  if (baud) {
+    setHostLink(kBaseBaud, false);
+    offered = true;
+    hostSend("0,INIT,BAUD," + std::to_string(baud) + ";");
+  } else {
+    hostSend("0,INIT;");
+  }
+  nextPing = hw::now() + kPingUs;
+}
+
+void SimHost::configure() {
+  hostSend(binary ? "0,CONFIG,BINARY;" : "0,CONFIG;");
+}
+
+void SimHost::requestStats() {
+  hostSend("0,STATS;");
+}
+
+// ------------------------------------ Board side -----------------------------------
+
+void SimHost::poll() {
+  std::vector<Frame>& frames = framesOut();
+  if (frames.size() < seen) {
+    seen = 0;                       // resetCounters() dropped them
+  }
+  while (seen < frames.size()) {
+    onFrame(frames[seen++].text);
+  }
+
+  uint64_t now = hw::now();
+  // No PONG at the new rate: back to 115200 and INIT without the offer
+  if (confirmBy && now >= confirmBy) {
+    confirmBy = 0;
+    fallbacks++;
+    linkBaud = kBaseBaud;
+    setHostLink(kBaseBaud, false);
+    hostSend("0,INIT;");
+  }
+  if (identEnds && now >= identEnds) {
+    identEnds = 0;
+    set("SIMCONNECT:TRANSPONDER IDENT", 0);
+  }
+  if (configured && now >= nextPing) {
+    hostSend("0,PING," + std::to_string(++pingCount) + ";");
+    nextPing += kPingUs;
+  }
+  // Values are sent one command each, as SPAD.neXt does, or batched in kValues commands
+  std::vector<std::pair<int, long>> batch;
+  std::vector<std::string> batched;
+  for (auto it = due.begin(); it != due.end();) {
+    if (it->second > now) {
+      ++it;
+      continue;
+    }
+    const std::string& variable = channels[it->first];
+    if (binaryOn) {
+      batch.push_back(std::make_pair(it->first, get(variable)));
+      batched.push_back(variable);
+    } else {
+      hostSend(std::to_string(it->first) + "," + value(variable) + ";");
+      state[variable].arrived = hw::uart.rxWireFree;
+    }
+    valuesSent++;
+    it = due.erase(it);
+  }
+  if (!batch.empty()) {
+    hostSend(binaryValues(batch));
+    for (const std::string& variable : batched) {
+      state[variable].arrived = hw::uart.rxWireFree;
+    }
+  }
+}
+
+void SimHost::onFrame(const std::string& text) {
+  // INIT answered: configure, the board subscribes while handling it. After an offer the
+  // BAUD reply comes first.
+  if (startsWith(text, "0,SPAD,")) {
+    if (!offered) {
+      configure();
+    }
+    return;
+  }
+  // "0,BAUD,<rate>": the last frame at 115200, switch and check the link with a PING
+  if (startsWith(text, "0,BAUD,")) {
+    offered = false;
+    unsigned long rate = strtoul(text.c_str() + 7, nullptr, 10);
+    if (rate == kBaseBaud) {
+      configure();
+      return;
+    }
+    linkBaud = rate;
+    setHostLink(portStuck ? kBaseBaud : rate, true);
+    hostSendAt("0,PING,0;", hw::now() + kSwitchUs);
+    confirmBy = hw::now() + kConfirmUs;
+    return;
+  }
+  if (confirmBy && text == "0,PONG,0") {
+    confirmBy = 0;
+    pongs++;
+    configure();
+    return;
+  }
+  if (startsWith(text, "0,STATS,")) {
+    readStats(text);
+    return;
+  }
+  if (text == "0,CONFIG" || text == "0,CONFIG,BINARY") {
+    configured = true;
+    binaryOn = text == "0,CONFIG,BINARY";
+    return;
+  }
+  if (startsWith(text, "0,PONG,")) {
+    pongs++;
+    return;
+  }
+  // "1,SUBSCRIBE,<channel>,<variable>": the current value follows
+  if (startsWith(text, "1,SUBSCRIBE,")) {
+    size_t comma = text.find(',', 12);
+    if (comma != std::string::npos) {
+      int channel = atoi(text.c_str() + 12);
+      channels[channel] = text.substr(comma + 1);
+      due[channel] = hw::now() + latency();
+    }
+    return;
+  }
+  if (startsWith(text, "1,UNSUBSCRIBE,")) {
+    int channel = atoi(text.c_str() + 14);
+    channels.erase(channel);
+    due.erase(channel);
+    return;
+  }
+  std::string event = simEvent(Frame{hw::now(), text});
+  if (!event.empty()) {
+    apply(event);
+  }
+}
+
+// "...,LINK,<baud>,<corrupt>,<lost>,<fallbacks>,..."
+void SimHost::readStats(const std::string& text) {
+  size_t link = text.find(",LINK,");
+  if (link == std::string::npos) {
+    return;
+  }
+  unsigned long rate = 0;
+  unsigned corrupt = 0, lost = 0, fell = 0;
+  if (sscanf(text.c_str() + link + 6, "%lu,%u,%u,%u", &rate, &corrupt, &lost, &fell) == 4) {
+    boardLink.seen = true;
+    boardLink.baud = rate;
+    boardLink.corrupt = corrupt;
+    boardLink.lost = lost;
+    boardLink.fallbacks = fell;
+  }
+}
+
+// ------------------------------------ Sim side -------------------------------------
+
+uint32_t SimHost::latency() {
+  // xorshift32, the same run for the same seed
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  return delayUs + (jitterUs ? random % (jitterUs + 1) : 0);
+}
+
+long SimHost::get(const std::string& variable) {
+  return state[variable].value;
+}
+
+void SimHost::set(const std::string& variable, long value) {
+  Variable& v = state[variable];
+  if (v.value == value) {
+    return;
+  }
+  v.value = value;
+  v.changed = hw::now();
+  // A value still waiting to be sent goes out with its first time, carrying the latest value
+  for (const auto& channel : channels) {
+    if (channel.second == variable && !due.count(channel.first)) {
+      due[channel.first] = hw::now() + latency();
+    }
+  }
+}
+
+void SimHost::swap(const std::string& active, const std::string& standby) {
+  long a = get(active);
+  set(active, get(standby));
+  set(standby, a);
+}
+
+// "SIMCONNECT:<name>[,<value>]" with the rules of the sim radios
+void SimHost::apply(const std::string& event) {
+  if (!startsWith(event, kPrefix)) {
+    eventsUnknown++;
+    return;
+  }
+  size_t comma = event.find(',');
+  std::string name = event.substr(strlen(kPrefix), comma == std::string::npos ? std::string::npos : comma - strlen(kPrefix));
+  long arg = comma == std::string::npos ? 0 : atol(event.c_str() + comma + 1);
+  int dir = name.find("_INC") != std::string::npos ? 1 : -1;
+
+  // --- COM / NAV: COM_RADIO_*, COM2_RADIO_*, NAV1_RADIO_*, NAV2_RADIO_*, *_SWAP, *_SET_HZ ---
+  bool com = startsWith(name, "COM");
+  bool nav = startsWith(name, "NAV");
+  if (com || nav) {
+    eventsApplied++;
+    const char* index = name[3] == '2' ? "2" : "1";
+    std::string standby = std::string(kPrefix) + (com ? "COM" : "NAV") + " STANDBY FREQUENCY:" + index;
+    std::string active = std::string(kPrefix) + (com ? "COM" : "NAV") + " ACTIVE FREQUENCY:" + index;
+    long v = get(standby);
+    if (name.find("_SWAP") != std::string::npos) {
+      swap(active, standby);
+    } else if (name.find("_SET_HZ") != std::string::npos) {
+      set(standby, arg / 1000);
+    } else if (name.find("_WHOLE_") != std::string::npos) {
+      set(standby, wrap(v / 1000 + dir, com ? 118 : 108, com ? 137 : 118) * 1000 + v % 1000);
+    } else if (com) {
+      set(standby, wrap(v + dir * 25, 118000, 137000));                   // Carry into Mhz
+    } else {
+      set(standby, v / 1000 * 1000 + wrap(v % 1000 + dir * 50, 0, 1000));  // No carry
+    }
+    return;
+  }
+
+  // --- ADF ---
+  if (startsWith(name, "ADF_")) {
+    eventsApplied++;
+    const std::string adf = std::string(kPrefix) + "ADF ACTIVE FREQUENCY:1";
+    const std::string card = std::string(kPrefix) + "ADF CARD";
+    long unit = 1;                                  // ADF_FRACT: 0.1 Khz with carry
+    if (startsWith(name, "ADF_1_")) unit = 10;
+    if (startsWith(name, "ADF_10_")) unit = 100;
+    if (startsWith(name, "ADF_100_")) unit = 1000;
+    if (name == "ADF_COMPLETE_SET") {
+      set(adf, fromBCD(arg) / 100);                 // BCD Hz
+    } else if (name == "ADF_CARD_SET") {
+      set(card, wrap(arg, 0, 360));
+    } else if (startsWith(name, "ADF_CARD_")) {
+      set(card, wrap(get(card) + dir, 0, 360));
+    } else {
+      set(adf, wrap(get(adf) + dir * unit, 1000, 18000));
+    }
+    return;
+  }
+
+  // --- Transponder: octal digits without carry ---
+  if (startsWith(name, "XPNDR_")) {
+    eventsApplied++;
+    const std::string code = std::string(kPrefix) + "TRANSPONDER CODE:1";
+    if (name == "XPNDR_SET") {
+      set(code, fromBCD(arg));                      // BCD16
+    } else if (name == "XPNDR_IDENT_ON") {
+      set(std::string(kPrefix) + "TRANSPONDER IDENT", 1);
+      identEnds = hw::now() + kIdentUs;
+    } else {
+      long scale = atol(name.c_str() + 6);          // XPNDR_<1|10|100|1000>_INC
+      long v = get(code);
+      long digit = v / scale % 10;
+      set(code, v + (wrap(digit + dir, 0, 8) - digit) * scale);
+    }
+    return;
+  }
+
+  eventsUnknown++;
+}
+
+// ------------------------------------ Values ---------------------------------------
+
+std::string SimHost::format(const std::string& variable, long value) const {
+  char text[32];
+  if (variable.find("ADF ACTIVE FREQUENCY") != std::string::npos) {
+    snprintf(text, sizeof(text), "%ld.%ld", value / 10, value % 10);
+  } else if (variable.find("FREQUENCY") != std::string::npos) {
+    snprintf(text, sizeof(text), "%ld.%03ld", value / 1000, value % 1000);
+  } else {
+    snprintf(text, sizeof(text), "%ld", value);
+  }
+  return text;
+}
+
+std::string SimHost::value(const std::string& variable) const {
+  auto it = state.find(variable);
+  return format(variable, it == state.end() ? 0 : it->second.value);
+}
+
+uint64_t SimHost::changedAt(const std::string& variable) const {
+  auto it = state.find(variable);
+  return it == state.end() ? 0 : it->second.changed;
+}
+
+uint64_t SimHost::arrivedAt(const std::string& variable) const {
+  auto it = state.find(variable);
+  return it == state.end() ? 0 : it->second.arrived;
+}
+
+}
@@ -0,0 +1,104 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : SPAD.neXt and simulator stand-in for the native
+*                     build. Answers the board over the modelled serial
+*                     wire like SPAD.neXt does (INIT, CONFIG, PING,
+*                     SUBSCRIBE), keeps the radio state of the sim,
+*                     applies the events the board sends and pushes the
+*                     changed values back after a delay with jitter.
+*                     Can offer a fast rate at INIT: it switches with
+*                     the board, confirms the framed link with a PING
+*                     and falls back to INIT at 115200 when no PONG
+*                     comes.
+*
+*/
+
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+
+namespace bench {
+
+class SimHost {
+public:
+  uint32_t delayUs = 0;             // Event applied to value sent back
+  uint32_t jitterUs = 0;            // Plus up to this much, uniformly
+  bool binary = false;              // Ask for kValues at CONFIG, then send the due values batched
+  unsigned long baud = 0;           // Offer this rate at INIT, 0 to stay at 115200
+  bool portStuck = false;           // The host port keeps 115200 whatever it is set to
+
+  explicit SimHost(uint32_t seed = 1);
+
+  // Start the handshake: INIT, CONFIG once the board answered, then the values
+  void start();
+  // Handle the frames the board sent since the last call and send the values that are
+  // due. Call before every loop() pass.
+  void poll();
+  bool connected() const { return configured; }
+  bool batching() const { return binaryOn; }
+  // Rate the link runs at, once connected
+  unsigned long rate() const { return linkBaud; }
+  // Ask for the board counters, see boardLink
+  void requestStats();
+
+  // Sim side value of a SimConnect variable ("SIMCONNECT:COM STANDBY FREQUENCY:1") as
+  // sent on the wire, and when it last changed / last reached the board
+  std::string value(const std::string& variable) const;
+  uint64_t changedAt(const std::string& variable) const;
+  uint64_t arrivedAt(const std::string& variable) const;
+
+  uint32_t eventsApplied = 0;
+  uint32_t eventsUnknown = 0;
+  uint32_t valuesSent = 0;
+  uint32_t pongs = 0;
+  uint32_t fallbacks = 0;           // Fast rate given up, INIT again at 115200
+
+  // LINK section of the last STATS reply: the board side of the link
+  struct BoardLink {
+    bool seen = false;
+    unsigned long baud = 0;
+    uint32_t corrupt = 0;
+    uint32_t lost = 0;
+    uint32_t fallbacks = 0;
+  } boardLink;
+
+private:
+  struct Variable {
+    long value = 0;                 // COM/NAV Khz, ADF 0.1 Khz, degrees, code, flag
+    uint64_t changed = 0;
+    uint64_t arrived = 0;
+  };
+
+  void onFrame(const std::string& text);
+  void apply(const std::string& event);
+  long get(const std::string& variable);
+  void set(const std::string& variable, long value);
+  void swap(const std::string& active, const std::string& standby);
+  std::string format(const std::string& variable, long value) const;
+  uint32_t latency();
+  void configure();
+  void readStats(const std::string& text);
+
+  std::map<std::string, Variable> state;
+  std::map<int, std::string> channels;      // Subscribed data channel -> variable
+  std::map<int, uint64_t> due;              // Data channel -> time its value is sent
+  size_t seen = 0;                          // framesOut() handled
+  bool configured = false;
+  bool binaryOn = false;                    // The board answered CONFIG with BINARY
+  bool offered = false;                     // INIT offered baud, the BAUD reply is due
+  unsigned long linkBaud = 0;
+  uint64_t confirmBy = 0;                   // Switched, PONG due by then. 0: not switching
+  uint64_t identEnds = 0;
+  uint64_t nextPing = 0;
+  uint32_t pingCount = 0;
+  uint32_t random;
+};
+
+}
+
+#endif
@@ -0,0 +1,851 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Benchmark suite for the native build.
+*                     Each workload runs in its own process on a fresh
+*                     setup() and reports loop() latency and message
+*                     throughput on the virtual clock.
+*
+* Usage             : program [workload]
+*                     program e2e [sim_delay_ms [sim_jitter_ms]]
+*                     program record <workload> <capture>
+*                     program replay <capture> [fast]
+*
+*/
+
+#include <Arduino.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include "Hardware.h"
+#include "Bench.h"
+#include "Capture.h"
+#include "SimHost.h"
+
+using namespace bench;
+
+static const uint64_t MS = 1000;
+
+// ------------------------------------ Scripts --------------------------------------
+
+// The 12 subscribed values, as SPAD.neXt sends them after CONFIG
+static const char* initialValues =
+  "10,350.5;11,118.000;12,121.500;13,110.500;14,113.900;15,124.350;"
+  "16,127.800;17,108.200;18,116.700;19,270;20,7000;21,0;";
+
+// INIT / CONFIG handshake followed by the initial values
+static void connect() {
+  hostSend("0,INIT;");
+  runFor(20 * MS);
+  hostSend("0,CONFIG;");
+  runFor(50 * MS);
+  hostSend(initialValues);
+  runFor(200 * MS);
+}
+
+// The sections of the last STATS reply, one frame each, as one line from the section
+// named from on. Empty when there is none.
+static std::string statsFrom(const char* from) {
+  std::string line;
+  for (const Frame& f : framesOut()) {
+    if (f.text.compare(0, 8, "0,STATS,") != 0) {
+      continue;
+    }
+    std::string section = f.text.substr(8);
+    if (section.compare(0, 5, "LOOP,") == 0) {
+      line.clear();
+    }
+    line += line.empty() ? section : "," + section;
+  }
+  size_t at = line.find(from);
+  return at == std::string::npos ? std::string() : line.substr(at);
+}
+
+// ----------------------------------- Workloads -------------------------------------
+
+// Nothing to do: cost of a bare loop() pass
+static void idle() {
+  connect();
+  resetCounters();
+  uint64_t start = hw::now();
+  runFor(1000 * MS);
+  report("idle", start, hw::commandsDispatched, framesOut().size());
+}
+
+// Handshake and value burst on a fresh board, until the values are on the screen
+static void burst() {
+  resetCounters();
+  uint64_t start = hw::now();
+  hostSend("0,INIT;");
+  hostSend("0,CONFIG;");
+  hostSend(initialValues);
+  uint64_t took = runUntil([] { return hw::lcd.row(0).find("118.000") != std::string::npos &&
+                                       hw::lcd.row(1).find("113.900") != std::string::npos; }, 2000 * MS);
+  runFor(100 * MS);
+  report("burst", start, hw::commandsDispatched, framesOut().size());
+  printf("             burst to screen: %llu us\n", (unsigned long long)took);
+  printScreen();
+  check(took < 2000 * MS, "values on the screen");
+}
+
+// Value updates back to back at full wire speed
+static void inbound() {
+  connect();
+  resetCounters();
+  uint64_t start = hw::now();
+  char line[32];
+  for (int i = 0; i < 2000; i++) {
+    snprintf(line, sizeof(line), "%d,%d.%03d;", 11 + i % 8, 118 + i % 18, (i * 25) % 1000);
+    hostSend(line);
+  }
+  runFor(2000 * MS);
+  report("inbound", start, hw::commandsDispatched, framesOut().size());
+}
+
+// Steady turn, 40 detents per second
+static void spin() {
+  connect();
+  resetCounters();
+  uint64_t start = hw::now();
+  turn(80, hw::now(), 25 * MS);
+  runFor(2500 * MS);
+  report("spin", start, hw::commandsDispatched, framesOut().size());
+}
+
+// Fast flick, 300 detents per second for half a second
+static void flick() {
+  connect();
+  resetCounters();
+  uint64_t start = hw::now();
+  turn(150, hw::now(), 3333);
+  runFor(1500 * MS);
+  report("flick", start, hw::commandsDispatched, framesOut().size());
+}
+
+// Brightness adjustment in config mode
+static void config() {
+  connect();
+  click(3);
+  runFor(50 * MS);
+  click(1);
+  runFor(50 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  turn(20, hw::now(), 50 * MS);
+  runFor(1000 * MS);
+  // Leave config mode, the settings are saved here
+  click(3);
+  runFor(50 * MS);
+  report("config", start, hw::commandsDispatched, framesOut().size());
+  printf("             eeprom writes: %u\n", hw::eeprom.writes);
+  check(hw::eeprom.writes > 0, "settings saved when leaving config mode");
+}
+
+// On-board instrumentation after a second of value traffic and turning
+static void stats() {
+  connect();
+  resetCounters();
+  uint64_t start = hw::now();
+  uint64_t next = hw::now();
+  int i = 0;
+  runFor(1000 * MS, [&] {
+    if (hw::now() >= next) {
+      char line[32];
+      snprintf(line, sizeof(line), "11,%d.%03d;", 118 + i % 18, (i * 25) % 1000);
+      hostSend(line);
+      turn(1, hw::now(), 4 * MS);
+      next += 20 * MS;
+      i++;
+    }
+  });
+  hostSend("0,STATS;");
+  runFor(50 * MS);
+  report("stats", start, hw::commandsDispatched, framesOut().size());
+  printf("             0,STATS,%s\n", statsFrom("LOOP").c_str());
+  check(statsFrom("LOOP").find("TASKS,EEPROM,") != std::string::npos, "whole STATS reply");
+  check(statsFrom("ENC,").compare(0, 6, "ENC,0,") == 0, "no detent lost");
+}
+
+// Turning before any value is known sends one INC/DEC event per detent
+static void eventsWith(const char* name, const char* config) {
+  hostSend("0,INIT;");
+  runFor(20 * MS);
+  hostSend(config);
+  runFor(500 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  turn(40, hw::now(), 50 * MS);
+  runFor(2500 * MS);
+  report(name, start, hw::commandsDispatched, framesOut().size());
+  size_t events = 0;
+  size_t bytes = 0;
+  std::string first;
+  for (const Frame& f : framesOut()) {
+    std::string event = simEvent(f);
+    if (event.empty()) {
+      continue;
+    }
+    events++;
+    bytes += f.text.size() + 1;
+    if (first.empty()) {
+      first = f.text + ";  ->  " + event;
+    }
+  }
+  printf("             %zu events, %.1f bytes each: %s\n", events, events ? (double)bytes / events : 0.0, first.c_str());
+  check(events == 40, "one event per detent");
+}
+
+static void events() {
+  eventsWith("events", "0,CONFIG;");
+}
+
+static void aliases() {
+  eventsWith("aliases", "0,CONFIG,ALIAS;");
+}
+
+// Long press now, returns the time until its swap event is on the wire and the sim events
+// that went out between the two
+static uint64_t pressToSwap(size_t& eventsBefore) {
+  size_t seen = framesOut().size();
+  uint64_t pressed = hw::now();
+  uint64_t wired = 0;
+  eventsBefore = 0;
+  longPress();
+  runUntil([&] {
+    for (; seen < framesOut().size(); seen++) {
+      std::string event = simEvent(framesOut()[seen]);
+      if (event.find("_SWAP") != std::string::npos) {
+        wired = framesOut()[seen].time;
+        return true;
+      }
+      if (!event.empty()) {
+        eventsBefore++;
+      }
+    }
+    return false;
+  }, 2000 * MS);
+  return wired ? wired - pressed : 0;
+}
+
+// Swap press to wire: after a fast turn forth and back before the values are known
+// (INC/DEC events, 33 bytes each), then in the middle of a re-CONFIG with aliases
+// (subscription and alias lines queued)
+static void swap() {
+  hostSend("0,INIT;");
+  runFor(20 * MS);
+  hostSend("0,CONFIG;");
+  runFor(500 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  uint64_t last = turn(40, hw::now(), 2 * MS);
+  last = turn(-30, last + 2 * MS, 2 * MS);
+  runFor(last - hw::now());
+  size_t turned = 0;
+  uint64_t afterTurn = pressToSwap(turned);
+  runFor(500 * MS);
+  size_t rotation = 0;
+  for (const Frame& f : framesOut()) {
+    std::string event = simEvent(f);
+    rotation += event.find("_INC") != std::string::npos || event.find("_DEC") != std::string::npos;
+  }
+
+  hostSend(initialValues);
+  runFor(200 * MS);
+  hostSend("0,CONFIG,ALIAS;");
+  runFor(5 * MS);
+  size_t queued = 0;
+  uint64_t behindConfig = pressToSwap(queued);
+  runFor(500 * MS);
+  report("swap", start, hw::commandsDispatched, framesOut().size());
+  printf("             press to wire: %llu us after +40/-30 detents (%zu INC/DEC events for them, %zu after "
+         "the press), %llu us behind CONFIG,ALIAS\n", (unsigned long long)afterTurn, rotation, turned,
+         (unsigned long long)behindConfig);
+  check(afterTurn != 0, "swap on the wire after the turn");
+  check(behindConfig != 0, "swap on the wire behind CONFIG,ALIAS");
+}
+
+// Connection refresh: the host re-sends the same values at 10 Hz
+static void refresh() {
+  connect();
+  hostSend("0,STATS;");
+  runFor(50 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  uint64_t next = hw::now();
+  runFor(2000 * MS, [&] {
+    if (hw::now() >= next) {
+      hostSend(initialValues);
+      next += 100 * MS;
+    }
+  });
+  hostSend("0,STATS;");
+  runFor(50 * MS);
+  report("refresh", start, hw::commandsDispatched, framesOut().size());
+  printf("             %s\n", statsFrom("FRAMES").c_str());
+  check(hw::lcd.bytes == 0, "no redraw for values that did not change");
+}
+
+// Two hours of session traffic: control events, pings, reconnects, value changes,
+// screen switches and turns. The firmware must not touch the heap.
+static void soak() {
+  connect();
+  hw::Heap before = hw::heap;
+  uint64_t start = hw::now();
+  resetCounters();
+  char line[48];
+  for (int second = 0; second < 2 * 3600; second++) {
+    uint64_t tick = hw::now();
+    snprintf(line, sizeof(line), "2,PROVIDER,MSFS,1;0,PING,%d;11,%d.%03d;", second, 118 + second % 18, (second * 25) % 1000);
+    hostSend(line);
+    if (second % 60 == 59) {
+      hostSend("2,END;2,START;0,INIT;0,CONFIG;");
+    }
+    if (second % 10 == 0) {
+      click(2);
+    }
+    if (second % 5 == 0) {
+      turn(second % 10 ? 3 : -3, hw::now(), 20 * MS);
+    }
+    // Active part of the second in loop(), the quiet rest skipped
+    runFor(100 * MS);
+    hw::advance(tick + 1000 * MS - hw::now());
+  }
+  report("soak", start, hw::commandsDispatched, framesOut().size());
+  printf("             %.1f h, heap: %llu allocations, %lld bytes live (was %lld)\n",
+         (hw::now() - start) / 3.6e9, (unsigned long long)(hw::heap.allocs - before.allocs),
+         (long long)hw::heap.liveBytes, (long long)before.liveBytes);
+  check(hw::heap.allocs == before.allocs, "no heap allocation");
+  check(hw::heap.liveBytes == before.liveBytes, "heap delta 0");
+}
+
+// Sim side values by data channel
+static const char* simValue(int channel) {
+  switch (channel) {
+    case 10: return "350.5";
+    case 11: return "118.000";
+    case 12: return "121.500";
+    case 13: return "110.500";
+    case 14: return "113.900";
+    case 15: return "124.350";
+    case 16: return "127.800";
+    case 17: return "108.200";
+    case 18: return "116.700";
+    case 19: return "270";
+    case 20: return "7000";
+    default: return "0";
+  }
+}
+
+// Walk through the screens while the host streams every subscribed value at 10 Hz
+static void screens() {
+  hostSend("0,INIT;");
+  runFor(20 * MS);
+  hostSend("0,CONFIG;");
+  runFor(100 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  uint64_t nextUpdate = hw::now();
+  uint64_t nextSwitch = hw::now() + 400 * MS;
+  uint64_t checkAt = 0;
+  int switches = 0;
+  int blank = 0;
+  size_t subscribedSum = 0;
+  runFor(12 * 400 * MS, [&] {
+    if (hw::now() >= nextUpdate) {
+      std::string burst;
+      for (const auto& sub : subscriptions()) {
+        burst += std::to_string(sub.first) + "," + simValue(sub.first) + ";";
+      }
+      hostSend(burst);
+      subscribedSum += subscriptions().size();
+      nextUpdate += 100 * MS;
+    }
+    if (hw::now() >= nextSwitch) {
+      click(2);
+      nextSwitch += 400 * MS;
+      checkAt = hw::now() + 50 * MS;
+      switches++;
+    }
+    // A radio never reads 0.000, so that is a value the board did not have yet
+    if (checkAt && hw::now() >= checkAt) {
+      checkAt = 0;
+      if (hw::lcd.row(0).find("0.000") != std::string::npos || hw::lcd.row(1).find("0.000") != std::string::npos) {
+        blank++;
+      }
+    }
+  });
+  report("screens", start, hw::commandsDispatched, framesOut().size());
+  printf("             %.1f channels subscribed on average, %d of %d screen switches without values after 50 ms\n",
+         (double)subscribedSum / 48, blank, switches);
+  check(blank == 0, "values on every screen 50 ms after the switch");
+}
+
+// One detent at a time on COM1 standby: time until the screen shows the new value, then
+// the sim confirms the first turn and ignores the second
+static void predict() {
+  connect();
+  hostSend("0,STATS;");
+  runFor(50 * MS);
+  resetCounters();
+  uint64_t start = hw::now();
+  std::string before = hw::lcd.row(0).substr(9, 7);
+  uint64_t from = hw::now();
+  uint64_t at = turn(1, from, 25 * MS);
+  uint64_t shown = from + runUntil([&] { return hw::lcd.row(0).substr(9, 7) != before; }, 500 * MS);
+  runFor(300 * MS);
+  // Confirmed: the sim sends back what the board shows
+  std::string predicted = hw::lcd.row(0).substr(9, 7);
+  hostSend("12," + predicted + ";");
+  runFor(100 * MS);
+  // Refused: the sim stays on the old value, the screen has to follow it
+  turn(1, hw::now(), 25 * MS);
+  runFor(300 * MS);
+  hostSend("12," + predicted + ";");
+  runFor(1500 * MS);
+  bool reverted = hw::lcd.row(0).substr(9, 7) == predicted;
+  hostSend("0,STATS;");
+  runFor(50 * MS);
+  report("predict", start, hw::commandsDispatched, framesOut().size());
+  printf("             detent to screen: %llu us, %s -> %s, %s after the refused step\n",
+         (unsigned long long)(shown - at), before.c_str(), predicted.c_str(),
+         reverted ? "reverted" : "NOT reverted");
+  printf("             %s\n", statsFrom("PREDICT").c_str());
+  check(shown - at < 500 * MS, "prediction on the screen");
+  check(predicted != before, "prediction shown");
+  check(reverted, "prediction reverted after the refused step");
+}
+
+// ---------------------------------- End to end -------------------------------------
+
+// Sim response of the e2e workload, see main()
+static uint32_t simDelayUs = 30 * MS;
+static uint32_t simJitterUs = 20 * MS;
+
+struct Gesture {
+  int detents;                  // Negative: counter clockwise
+  uint32_t periodUs;
+  uint32_t pauseUs;             // After the last detent, before the next gesture
+};
+
+// Pilot scripts on COM1 standby: single clicks, slow dialling (Khz) and fast spins (Mhz)
+static std::vector<Gesture> script(int count, int detents, uint32_t periodUs, uint32_t seed) {
+  std::vector<Gesture> gestures;
+  for (int i = 0; i < count; i++) {
+    seed = seed * 1103515245 + 12345;
+    int dir = (seed >> 16) & 1 ? 1 : -1;
+    gestures.push_back(Gesture{dir * detents, periodUs, (uint32_t)(400 * MS + (seed >> 8) % (500 * MS))});
+  }
+  return gestures;
+}
+
+// For each gesture, from its last detent to: the screen showing the value the sim ends up
+// with, the sim having it, and the sim value being back on the board. Returns the report line,
+// disagree is the number of gestures after which the screen and the sim differ.
+static std::string pilot(SimHost& sim, const char* name, const std::vector<Gesture>& gestures, int& disagree) {
+  const std::string variable = "SIMCONNECT:COM STANDBY FREQUENCY:1";
+  Samples display;
+  Samples simUs;
+  Samples echo;
+  disagree = 0;
+  for (const Gesture& g : gestures) {
+    uint64_t first = hw::now();
+    uint64_t last = turn(g.detents, first, g.periodUs);
+    uint64_t shown = 0;
+    std::string wanted;
+    std::string before = hw::lcd.row(0).substr(9, 7);
+    std::vector<std::pair<uint64_t, std::string>> changes;
+    runFor(last + g.pauseUs - hw::now(), [&] {
+      sim.poll();
+      std::string field = hw::lcd.row(0).substr(9, 7);
+      if (field != (changes.empty() ? before : changes.back().second)) {
+        changes.push_back(std::make_pair(hw::now(), field));
+      }
+    });
+    wanted = sim.value(variable);
+    if (hw::lcd.row(0).substr(9, 7) != wanted) {
+      disagree++;
+    }
+    for (const auto& change : changes) {
+      if (change.second == wanted) {
+        shown = change.first;
+        break;
+      }
+    }
+    if (shown == 0 || sim.changedAt(variable) < first) {
+      continue;                 // Nothing changed (wrapped around) or never shown
+    }
+    display.add(shown > last ? (uint32_t)(shown - last) : 0);
+    simUs.add((uint32_t)(sim.changedAt(variable) > last ? sim.changedAt(variable) - last : 0));
+    echo.add((uint32_t)(sim.arrivedAt(variable) > last ? sim.arrivedAt(variable) - last : 0));
+  }
+  char line[192];
+  snprintf(line, sizeof(line), "             %-6s %2zu turns, display p50 %6u p99 %6u us, sim p50 %6u p99 %6u us, "
+           "echo p50 %6u p99 %6u us, %d disagree\n",
+           name, display.count(), display.percentile(50), display.percentile(99), simUs.percentile(50),
+           simUs.percentile(99), echo.percentile(50), echo.percentile(99), disagree);
+  return line;
+}
+
+// Closed loop: the board against the sim stand-in, knob to screen
+static void e2e() {
+  SimHost sim;
+  sim.delayUs = simDelayUs;
+  sim.jitterUs = simJitterUs;
+  sim.start();
+  runUntil([&] { sim.poll(); return sim.connected() && hw::lcd.row(0).find("121.500") != std::string::npos; },
+           2000 * MS);
+  resetCounters();
+  sim.poll();
+  uint64_t start = hw::now();
+  std::vector<std::pair<const char*, std::vector<Gesture>>> scripts = {
+    { "click", script(30, 1, 50 * MS, 1) },
+    { "dial", script(15, 6, 120 * MS, 2) },
+    { "spin", script(10, 12, 40 * MS, 3) },
+  };
+  std::string lines;
+  int disagree = 0;
+  for (const auto& s : scripts) {
+    int differ = 0;
+    lines += pilot(sim, s.first, s.second, differ);
+    disagree += differ;
+  }
+  report("e2e", start, hw::commandsDispatched, framesOut().size());
+  printf("%s", lines.c_str());
+  printf("             sim delay %u ms + up to %u ms, %u events applied, %u unknown, %u values sent, %u pongs\n",
+         simDelayUs / 1000, simJitterUs / 1000, sim.eventsApplied, sim.eventsUnknown, sim.valuesSent, sim.pongs);
+  check(disagree == 0, "screen and sim agree after every gesture");
+  check(sim.eventsUnknown == 0, "no unknown event");
+}
+
+// The burst workload with the values batched in binary kValues commands, then single
+// clicks against the sim stand-in sending its values the same way
+static void binary() {
+  std::vector<std::pair<int, long>> values = {
+    { 10, 3505 }, { 11, 118000 }, { 12, 121500 }, { 13, 110500 }, { 14, 113900 }, { 15, 124350 },
+    { 16, 127800 }, { 17, 108200 }, { 18, 116700 }, { 19, 270 }, { 20, 7000 }, { 21, 0 },
+  };
+  std::string batched = binaryValues(values);
+  resetCounters();
+  uint64_t start = hw::now();
+  hostSend("0,INIT;");
+  hostSend("0,CONFIG,BINARY;");
+  hostSend(batched);
+  uint64_t took = runUntil([] { return hw::lcd.row(0).find("118.000") != std::string::npos &&
+                                       hw::lcd.row(1).find("113.900") != std::string::npos; }, 2000 * MS);
+  runFor(100 * MS);
+  report("binary", start, hw::commandsDispatched, framesOut().size());
+  printf("             burst to screen: %llu us, 12 values in %zu bytes / %zu commands (text %zu / 12)\n",
+         (unsigned long long)took, batched.size(), (size_t)std::count(batched.begin(), batched.end(), ';'),
+         strlen(initialValues));
+  check(took < 2000 * MS, "values on the screen");
+
+  SimHost sim;
+  sim.binary = true;
+  sim.delayUs = simDelayUs;
+  sim.jitterUs = simJitterUs;
+  sim.start();
+  runUntil([&] { sim.poll(); return sim.connected(); }, 2000 * MS);
+  int disagree = 0;
+  printf("%s", pilot(sim, "click", script(30, 1, 50 * MS, 1), disagree).c_str());
+  printf("             sim values %s, %u sent, %u events applied\n",
+         sim.batching() ? "batched" : "one per command", sim.valuesSent, sim.eventsApplied);
+  check(sim.batching(), "sim values batched");
+  check(disagree == 0, "screen and sim agree after every click");
+}
+
+// The sim stand-in offers 1 Mbaud at INIT: clicks on the framed link, clean and with wire
+// noise, the board counters checked against the host ones. Then the host goes away and one
+// whose port cannot switch connects: both sides fall back to 115200.
+static void baud() {
+  SimHost sim;
+  sim.baud = 1000000;
+  sim.delayUs = simDelayUs;
+  sim.jitterUs = simJitterUs;
+  sim.start();
+  uint64_t took = runUntil([&] { sim.poll(); return sim.connected() && hw::lcd.row(0).find("121.500") != std::string::npos; },
+                           2000 * MS);
+  resetCounters();
+  sim.poll();
+  uint64_t start = hw::now();
+  int disagree = 0;
+  std::string clean = pilot(sim, "clean", script(30, 1, 50 * MS, 1), disagree);
+  check(disagree == 0, "screen and sim agree after every click on the clean link");
+  sim.requestStats();
+  runFor(100 * MS, [&] { sim.poll(); });
+  SimHost::BoardLink quiet = sim.boardLink;
+  LinkCounters host = hostLink;
+
+  const uint32_t every = 200;
+  setNoise(every);
+  int noisyDisagree = 0;
+  std::string noisy = pilot(sim, "noisy", script(30, 1, 50 * MS, 4), noisyDisagree);
+  setNoise(0);
+  uint32_t flippedIn = hw::uart.noisyIn;
+  uint32_t flippedOut = hw::uart.noisyOut;
+  sim.requestStats();
+  runFor(100 * MS, [&] { sim.poll(); });
+  report("baud", start, hw::commandsDispatched, framesOut().size());
+  printf("             %lu baud after INIT, values on screen in %llu us\n", sim.rate(), (unsigned long long)took);
+  printf("%s", clean.c_str());
+  printf("             clean: board %u corrupt %u lost, host %u corrupt %u lost\n",
+         quiet.corrupt, quiet.lost, host.corrupt, host.lost);
+  printf("%s", noisy.c_str());
+  const SimHost::BoardLink& board = sim.boardLink;
+  bool detected = quiet.seen && quiet.corrupt + quiet.lost + host.corrupt + host.lost == 0 && board.seen &&
+                  (flippedIn == 0 || (board.corrupt > 0 && board.lost >= board.corrupt)) &&
+                  (flippedOut == 0 || (hostLink.corrupt > 0 && hostLink.lost >= hostLink.corrupt));
+  printf("             noise every %u bytes: %u flipped to the board, %u corrupt %u lost there; %u to the host, "
+         "%u corrupt %u lost: %s\n", every, flippedIn, board.corrupt, board.lost, flippedOut, hostLink.corrupt,
+         hostLink.lost, detected ? "all detected" : "MISSED");
+  check(sim.rate() == 1000000, "1000000 baud after INIT");
+  check(detected, "every corrupt frame detected");
+
+  // The host is gone: no frames, the board goes back to 115200 by itself
+  uint64_t silent = hw::now();
+  runUntil([] { return hw::uart.baud == 115200; }, 5000 * MS);
+  printf("             host gone: board at %lu baud after %llu ms\n", hw::uart.baud,
+         (unsigned long long)(hw::now() - silent) / MS);
+  check(hw::uart.baud == 115200, "back to 115200 without a host");
+
+  resetCounters();
+  SimHost stuck(2);
+  stuck.baud = 1000000;
+  stuck.portStuck = true;
+  stuck.start();
+  took = runUntil([&] { stuck.poll(); return stuck.connected(); }, 5000 * MS);
+  stuck.requestStats();
+  runFor(100 * MS, [&] { stuck.poll(); });
+  printf("             port stuck at 115200: connected at %lu baud in %llu ms, host %u fallback, board at %lu "
+         "baud, %u fallbacks\n", stuck.rate(), (unsigned long long)took / MS, stuck.fallbacks,
+         stuck.boardLink.baud, stuck.boardLink.fallbacks);
+  check(stuck.connected() && stuck.rate() == 115200, "connected at 115200 with a stuck port");
+}
+
+// ------------------------------------ Replay ---------------------------------------
+
+static Samples handlingUs;
+static const uint64_t captureTailUs = 2000 * MS;    // Settle, SET and prediction timeouts
+
+static void onDispatch(uint64_t arrivedUs, uint64_t doneUs) {
+  handlingUs.add((uint32_t)(doneUs - arrivedUs));
+}
+
+static double hostSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Play a capture into a fresh board: host bytes, encoder edges, clicks and host port
+// changes at their recorded times, shifted to start now. Fast skips the quiet time between them in steps of up to
+// fastStepUs, like soak does. Returns false when the sim events differ from the recording.
+static bool replay(const Capture& capture, bool fast) {
+  const uint64_t fastStepUs = 5 * MS;
+  if (capture.records.empty()) {
+    printf("replay       empty capture\n");
+    return false;
+  }
+  uint64_t first = capture.records.front().time;
+  uint64_t last = first;
+  for (const Record& r : capture.records) {
+    first = std::min(first, r.time);
+    last = std::max(last, r.time);
+  }
+  uint64_t base = hw::now();
+  std::vector<Frame> expected;
+  std::vector<Record> timed;
+  unsigned long baud = 0;
+  for (const Record& r : capture.records) {
+    uint64_t at = base + (r.time - first);
+    if (r.kind == '<') {
+      hw::uart.hostSend(r.data, at, baud);
+    } else if (r.kind == 'P') {
+      int pin = 0;
+      int level = 0;
+      sscanf(r.data.c_str(), "%d %d", &pin, &level);
+      hw::scheduleInput(at, pin, level);
+    } else if (r.kind == 'C' || r.kind == 'L' || r.kind == 'B' || r.kind == 'N') {
+      if (r.kind == 'B') {
+        baud = strtoul(r.data.c_str(), nullptr, 10);
+      }
+      timed.push_back(Record{at, r.kind, r.data});
+    } else if (r.kind == '>') {
+      std::string text = r.data;
+      if (!text.empty() && text.back() == ';') {
+        text.pop_back();
+      }
+      expected.push_back(Frame{at, text});
+    }
+  }
+
+  resetCounters();
+  handlingUs.values.clear();
+  hw::onDispatch = onDispatch;
+  uint64_t end = base + (last - first) + captureTailUs;
+  size_t next = 0;
+  double hostStart = hostSeconds();
+  while (hw::now() < end) {
+    while (next < timed.size() && timed[next].time <= hw::now()) {
+      const Record& t = timed[next++];
+      if (t.kind == 'C') {
+        click(atoi(t.data.c_str()));
+      } else if (t.kind == 'L') {
+        longPress();
+      } else if (t.kind == 'B') {
+        unsigned long rate = 0;
+        int framed = 0;
+        sscanf(t.data.c_str(), "%lu %d", &rate, &framed);
+        setHostLink(rate, framed != 0);
+      } else {
+        setNoise(strtoul(t.data.c_str(), nullptr, 10));
+      }
+    }
+    step();
+    if (fast && hw::uart.rx.empty()) {
+      uint64_t until = std::min(hw::nextExternalEvent(), end);
+      if (next < timed.size()) {
+        until = std::min(until, timed[next].time);
+      }
+      if (until > hw::now()) {
+        hw::advance(std::min(until - hw::now(), fastStepUs));
+      }
+    }
+  }
+  double hostTook = hostSeconds() - hostStart;
+  hw::onDispatch = nullptr;
+  collectFrames();
+
+  report(fast ? "replay fast" : "replay", base, hw::commandsDispatched, framesOut().size());
+  double seconds = (hw::now() - base) / 1e6;
+  printf("             %zu messages in %.1f s, %.0f msg/s; host %.2f s, %.0f msg/s\n",
+         handlingUs.count(), seconds, handlingUs.count() / seconds, hostTook,
+         hostTook > 0 ? handlingUs.count() / hostTook : 0.0);
+  printf("             handling (';' on the wire to callback done) p50 %u us, p99 %u us, max %u us\n",
+         handlingUs.percentile(50), handlingUs.percentile(99), handlingUs.max());
+
+  std::vector<std::string> want = simEvents(expected);
+  std::vector<std::string> got = simEvents(framesOut());
+  size_t same = 0;
+  while (same < want.size() && same < got.size() && want[same] == got[same]) {
+    same++;
+  }
+  if (same == want.size() && same == got.size()) {
+    printf("             sim events: %zu, same as recorded\n", want.size());
+    return true;
+  }
+  printf("             sim events: %zu recorded, %zu replayed, first difference at #%zu: %s / %s\n",
+         want.size(), got.size(), same + 1,
+         same < want.size() ? want[same].c_str() : "(none)",
+         same < got.size() ? got[same].c_str() : "(none)");
+  return false;
+}
+
+// ------------------------------------- Main ----------------------------------------
+
+struct Workload {
+  const char* name;
+  void (*run)();
+};
+
+static const Workload workloads[] = {
+  { "idle", idle },
+  { "burst", burst },
+  { "binary", binary },
+  { "baud", baud },
+  { "inbound", inbound },
+  { "spin", spin },
+  { "flick", flick },
+  { "config", config },
+  { "stats", stats },
+  { "events", events },
+  { "aliases", aliases },
+  { "swap", swap },
+  { "screens", screens },
+  { "refresh", refresh },
+  { "predict", predict },
+  { "e2e", e2e },
+  { "soak", soak },
+};
+
+static const Workload* findWorkload(const char* name) {
+  for (const Workload& w : workloads) {
+    if (strcmp(name, w.name) == 0) {
+      return &w;
+    }
+  }
+  return nullptr;
+}
+
+// Run one workload and write what went over the serial port and the inputs to a capture
+static int record(const char* name, const char* path) {
+  const Workload* w = findWorkload(name);
+  if (!w) {
+    printf("unknown workload %s\n", name);
+    return 2;
+  }
+  Capture capture;
+  printHeader();
+  setup();
+  recording = &capture;
+  w->run();
+  // What the board still sends after the last input, replay waits as long
+  runFor(captureTailUs);
+  recording = nullptr;
+  if (!capture.save(path)) {
+    printf("cannot write %s\n", path);
+    return 2;
+  }
+  printf("             %zu records written to %s\n", capture.records.size(), path);
+  return checkFailures() ? 1 : 0;
+}
+
+static int replayFile(const char* path, bool fast) {
+  Capture capture;
+  if (!capture.load(path)) {
+    printf("cannot read %s\n", path);
+    return 2;
+  }
+  printHeader();
+  setup();
+  check(replay(capture, fast), "sim events as recorded");
+  return checkFailures() ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 3 && strcmp(argv[1], "record") == 0) {
+    return record(argv[2], argv[3]);
+  }
+  if (argc > 2 && strcmp(argv[1], "replay") == 0) {
+    return replayFile(argv[2], argc > 3 && strcmp(argv[3], "fast") == 0);
+  }
+  if (argc > 2 && strcmp(argv[1], "e2e") == 0) {
+    simDelayUs = atoi(argv[2]) * MS;
+    simJitterUs = argc > 3 ? atoi(argv[3]) * MS : 0;
+  }
+  const char* only = argc > 1 ? argv[1] : nullptr;
+  int failures = 0;
+
+  printHeader();
+  for (const Workload& w : workloads) {
+    if (only && strcmp(only, w.name) != 0) {
+      continue;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      setup();
+      w.run();
+      fflush(stdout);
+      _exit(checkFailures() ? 1 : 0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      printf("%-12s FAILED\n", w.name);
+      failures++;
+    }
+  }
+  return failures ? 1 : 0;
+}
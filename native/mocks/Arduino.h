@@ -0,0 +1,191 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Arduino core stand-in for the native (host) build.
+*                     Time is virtual: every hardware access charges
+*                     its cost on the virtual clock, see Hardware.h.
+*
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH          0x1
+#define LOW           0x0
+#define INPUT         0x0
+#define OUTPUT        0x1
+#define INPUT_PULLUP  0x2
+
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+
+#define DEC           10
+#define HEX           16
+#define OCT           8
+#define BIN           2
+
+// Arduino Uno analog pins
+#define A0            14
+#define A1            15
+#define A2            16
+#define A3            17
+#define A4            18
+#define A5            19
+#define NUM_DIGITAL_PINS 20
+
+// ------------------------------------ PROGMEM --------------------------------------
+// Flash and RAM share one address space on the host
+
+#define PROGMEM
+#define PSTR(s)               (s)
+// Words are read as the AVR reads them, the low bytes first, copied out so the
+// pointer type does not matter (an unsigned long is 8 bytes on the host)
+#define pgm_read_byte(p)      (*(const uint8_t*)(p))
+#define pgm_read_word(p)      pgmReadWord(p)
+#define pgm_read_dword(p)     pgmReadDword(p)
+#define pgm_read_ptr(p)       pgmReadPtr(p)
+
+inline uint16_t pgmReadWord(const void* p) {
+  uint16_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t pgmReadDword(const void* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void* pgmReadPtr(const void* p) {
+  void* v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+#define strcmp_P              strcmp
+#define strncmp_P             strncmp
+#define strlen_P              strlen
+#define memcmp_P              memcmp
+#define memcpy_P              memcpy
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// ------------------------------------ Core API -------------------------------------
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+void attachInterrupt(uint8_t interruptNum, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts();
+void interrupts();
+
+template <class A, class B> inline auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+template <class A, class B> inline auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// ------------------------------------- String --------------------------------------
+// Heap backed, like the AVR one, so allocations show up in the heap counters
+
+class String {
+public:
+  String(const char* s = "");
+  String(const String& other);
+  ~String();
+  String& operator=(const String& other);
+  bool operator==(const char* s) const { return strcmp(buf, s) == 0; }
+  bool operator==(const String& s) const { return strcmp(buf, s.buf) == 0; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+  const char* c_str() const { return buf; }
+  unsigned int length() const { return len; }
+
+private:
+  void assign(const char* s);
+  void release();
+  char* buf;
+  unsigned int len;
+};
+
+// ----------------------------------- Print / Stream --------------------------------
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const char s[]) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits = 2);
+  size_t print(bool b) { return print((int)b); }
+
+  template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  size_t println() { return write("\r\n"); }
+
+private:
+  size_t printNumber(unsigned long n, int base);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(char* buffer, size_t length);
+};
+
+// ------------------------------------ Serial ---------------------------------------
+// UART with the Uno buffer sizes. The wire itself is modelled in Hardware.h.
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud);
+  void end();
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+  virtual int availableForWrite();
+  virtual void flush();
+  virtual size_t write(uint8_t c);
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,285 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : CmdMessenger stand-in for the native build.
+*
+*/
+
+#include "CmdMessenger.h"
+#include "Hardware.h"
+
+CmdMessenger::CmdMessenger(Stream& c, const char fldSeparator, const char cmdSeparator, const char escCharacter) {
+  comms = &c;
+  fieldSeparator = fldSeparator;
+  commandSeparator = cmdSeparator;
+  escapeCharacter = escCharacter;
+  memset(callbackList, 0, sizeof(callbackList));
+  reset();
+}
+
+void CmdMessenger::attach(byte msgId, messengerCallbackFunction newFunction) {
+  if (msgId < MAXCALLBACKS) {
+    callbackList[msgId] = newFunction;
+  }
+}
+
+// ------------------------------------ Receive --------------------------------------
+
+void CmdMessenger::feedinSerialData() {
+  while (!pauseProcessing && comms->available()) {
+    size_t bytesAvailable = min(comms->available(), MAXSTREAMBUFFERSIZE);
+    comms->readBytes(streamBuffer, bytesAvailable);
+    for (size_t byteNo = 0; byteNo < bytesAvailable; byteNo++) {
+      hw::advance(hw::cost::parseByte);
+      uint64_t arrived = hw::uart.takeArrival(streamBuffer[byteNo]);
+      if (processLine(streamBuffer[byteNo]) == kEndOfMessage) {
+        handleMessage();
+        if (hw::onDispatch) {
+          hw::onDispatch(arrived, hw::now());
+        }
+      }
+    }
+  }
+}
+
+uint8_t CmdMessenger::processLine(char serialChar) {
+  messageState = kProccesingMessage;
+  bool escaped = isEscaped(&serialChar, escapeCharacter, &cmdLastChar);
+  if (serialChar == commandSeparator && !escaped) {
+    commandBuffer[bufferIndex] = 0;
+    if (bufferIndex > 0) {
+      messageState = kEndOfMessage;
+      current = commandBuffer;
+      cmdLastChar = '\0';
+    }
+    reset();
+  } else {
+    commandBuffer[bufferIndex] = serialChar;
+    bufferIndex++;
+    // Overlong commands are dropped, like the library does
+    if (bufferIndex >= MESSENGERBUFFERSIZE - 1) {
+      reset();
+    }
+  }
+  return messageState;
+}
+
+void CmdMessenger::handleMessage() {
+  hw::advance(hw::cost::dispatch);
+  hw::commandsDispatched++;
+  lastCommandId = readInt16Arg();
+  if (lastCommandId >= 0 && lastCommandId < MAXCALLBACKS && argOk && callbackList[lastCommandId] != nullptr) {
+    callbackList[lastCommandId]();
+  } else if (defaultCallback != nullptr) {
+    defaultCallback();
+  }
+}
+
+void CmdMessenger::reset() {
+  bufferIndex = 0;
+  current = nullptr;
+  last = nullptr;
+  dumped = true;
+}
+
+bool CmdMessenger::isEscaped(char* currChar, const char escapeChar, char* lastChar) {
+  bool escaped = (*lastChar == escapeChar);
+  *lastChar = *currChar;
+  // An escaped escape character does not escape the next one
+  if (*lastChar == escapeCharacter && escaped) {
+    *lastChar = '\0';
+  }
+  return escaped;
+}
+
+bool CmdMessenger::next() {
+  char* temppointer = nullptr;
+  switch (messageState) {
+  case kProccesingMessage:
+    return false;
+  case kEndOfMessage:
+    temppointer = commandBuffer;
+    messageState = kProcessingArguments;
+    // fall through
+  default:
+    if (dumped) {
+      current = splitR(temppointer, fieldSeparator, &last);
+    }
+    // The field is only taken by the read that follows, available() just looks
+    if (current != nullptr) {
+      dumped = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+int16_t CmdMessenger::readInt16Arg() {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return atoi(current);
+  }
+  argOk = false;
+  return 0;
+}
+
+int32_t CmdMessenger::readInt32Arg() {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return atol(current);
+  }
+  argOk = false;
+  return 0;
+}
+
+char CmdMessenger::readCharArg() {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return current[0];
+  }
+  argOk = false;
+  return 0;
+}
+
+float CmdMessenger::readFloatArg() {
+  return (float)readDoubleArg();
+}
+
+double CmdMessenger::readDoubleArg() {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return strtod(current, nullptr);
+  }
+  argOk = false;
+  return 0;
+}
+
+char* CmdMessenger::readStringArg() {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return current;
+  }
+  // As the library: NULL past the last argument, and no unescaping
+  argOk = false;
+  return nullptr;
+}
+
+void CmdMessenger::copyStringArg(char* string, uint8_t size) {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    strncpy(string, current, size);
+    string[size - 1] = 0;
+  } else {
+    argOk = false;
+    if (size) {
+      string[0] = '\0';
+    }
+  }
+}
+
+uint8_t CmdMessenger::compareStringArg(char* string) {
+  if (next()) {
+    dumped = true;
+    argOk = true;
+    return strcmp(string, current) == 0;
+  }
+  argOk = false;
+  return 0;
+}
+
+void CmdMessenger::unescape(char* fromChar) {
+  char* toChar = fromChar;
+  while (*fromChar != '\0') {
+    if (*fromChar == escapeCharacter) {
+      fromChar++;
+    }
+    *toChar++ = *fromChar++;
+  }
+  for (; toChar < fromChar; toChar++) {
+    *toChar = '\0';
+  }
+}
+
+int CmdMessenger::findNext(char* str, char delim) {
+  int pos = 0;
+  argLastChar = '\0';
+  while (true) {
+    bool escaped = isEscaped(str, escapeCharacter, &argLastChar);
+    if (*str == '\0' && !escaped) {
+      return pos;
+    }
+    if (*str == delim && !escaped) {
+      return pos;
+    }
+    str++;
+    pos++;
+  }
+}
+
+char* CmdMessenger::splitR(char* str, const char delim, char** nextp) {
+  if (str == nullptr) {
+    str = *nextp;
+  }
+  if (str == nullptr) {
+    return nullptr;
+  }
+  while (findNext(str, delim) == 0 && *str) {
+    str++;
+  }
+  if (*str == '\0') {
+    return nullptr;
+  }
+  char* ret = str;
+  str += findNext(str, delim);
+  if (*str) {
+    *str++ = '\0';
+  }
+  *nextp = str;
+  return ret;
+}
+
+// -------------------------------------- Send ---------------------------------------
+
+void CmdMessenger::sendCmdStart(byte cmdId) {
+  if (!startCommand) {
+    startCommand = true;
+    pauseProcessing = true;
+    comms->print(cmdId);
+  }
+}
+
+void CmdMessenger::sendCmdEscArg(char* arg) {
+  if (startCommand) {
+    comms->print(fieldSeparator);
+    while (*arg) {
+      printEsc(*arg++);
+    }
+  }
+}
+
+// No acknowledgements on the bench, the arguments are the library's
+bool CmdMessenger::sendCmdEnd(bool, byte, unsigned int) {
+  if (startCommand) {
+    comms->print(commandSeparator);
+    if (printNewlines) {
+      comms->println();
+    }
+  }
+  pauseProcessing = false;
+  startCommand = false;
+  return false;
+}
+
+void CmdMessenger::printEsc(char c) {
+  if (c == fieldSeparator || c == commandSeparator || c == escapeCharacter || c == '\0') {
+    comms->print(escapeCharacter);
+  }
+  comms->print(c);
+}
@@ -0,0 +1,139 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : CmdMessenger stand-in for the native build.
+*                     Same wire format and buffer sizes as CmdMessenger
+*                     4.x: fields split on ',', commands end on ';',
+*                     '/' escapes, 64 byte command buffer.
+*
+*/
+
+#ifndef CMD_MESSENGER_H
+#define CMD_MESSENGER_H
+
+#include <Arduino.h>
+
+#define MAXCALLBACKS        50
+#define MESSENGERBUFFERSIZE 64
+#define MAXSTREAMBUFFERSIZE 512
+#define DEFAULT_TIMEOUT     5000
+
+typedef void (*messengerCallbackFunction)(void);
+
+class CmdMessenger {
+public:
+  CmdMessenger(Stream& comms, const char fldSeparator = ',', const char cmdSeparator = ';',
+               const char escCharacter = '/');
+
+  void printLfCr(bool addNewLine = true) { printNewlines = addNewLine; }
+  void attach(messengerCallbackFunction newFunction) { defaultCallback = newFunction; }
+  void attach(byte msgId, messengerCallbackFunction newFunction);
+
+  void feedinSerialData();
+  bool next();
+  bool available() { return next(); }
+  bool isArgOk() { return argOk; }
+  uint8_t commandID() { return lastCommandId; }
+
+  // ----- Send -----
+  bool sendCmd(byte cmdId) {
+    if (startCommand) return false;
+    sendCmdStart(cmdId);
+    return sendCmdEnd();
+  }
+  template <class T>
+  bool sendCmd(byte cmdId, T arg, bool reqAc = false, byte ackCmdId = 1, unsigned int timeout = DEFAULT_TIMEOUT) {
+    if (startCommand) return false;
+    sendCmdStart(cmdId);
+    sendCmdArg(arg);
+    return sendCmdEnd(reqAc, ackCmdId, timeout);
+  }
+  void sendCmdStart(byte cmdId);
+  void sendCmdEscArg(char* arg);
+  template <class T>
+  void sendCmdArg(T arg) {
+    if (startCommand) {
+      comms->print(fieldSeparator);
+      comms->print(arg);
+    }
+  }
+  template <class T>
+  void sendCmdArg(T arg, unsigned int n) {
+    if (startCommand) {
+      comms->print(fieldSeparator);
+      comms->print(arg, n);
+    }
+  }
+  template <class T>
+  void sendCmdBinArg(T arg) {
+    if (startCommand) {
+      comms->print(fieldSeparator);
+      const char* p = (const char*)(const void*)&arg;
+      for (unsigned int i = 0; i < sizeof(arg); i++) {
+        printEsc(p[i]);
+      }
+    }
+  }
+  bool sendCmdEnd(bool reqAc = false, byte ackCmdId = 1, unsigned int timeout = DEFAULT_TIMEOUT);
+
+  // ----- Receive -----
+  bool readBoolArg() { return readInt16Arg() != 0; }
+  int16_t readInt16Arg();
+  int32_t readInt32Arg();
+  char readCharArg();
+  float readFloatArg();
+  double readDoubleArg();
+  char* readStringArg();
+  void copyStringArg(char* string, uint8_t size);
+  uint8_t compareStringArg(char* string);
+  template <class T>
+  T readBinArg() {
+    T value;
+    memset(&value, 0, sizeof(value));
+    // As the library: no isArgOk() update for binary arguments
+    if (next()) {
+      dumped = true;
+      unescape(current);
+      memcpy(&value, current, sizeof(value));
+    }
+    return value;
+  }
+  void unescape(char* fromChar);
+
+private:
+  enum { kProccesingMessage, kEndOfMessage, kProcessingArguments };
+
+  uint8_t processLine(char serialChar);
+  void handleMessage();
+  void reset();
+  bool isEscaped(char* currChar, const char escapeChar, char* lastChar);
+  int findNext(char* str, char delim);
+  char* splitR(char* str, const char delim, char** nextp);
+  void printEsc(char c);
+
+  Stream* comms;
+  char fieldSeparator;
+  char commandSeparator;
+  char escapeCharacter;
+  bool printNewlines = false;
+  bool startCommand = false;
+  bool pauseProcessing = false;
+
+  messengerCallbackFunction defaultCallback = nullptr;
+  messengerCallbackFunction callbackList[MAXCALLBACKS];
+
+  char commandBuffer[MESSENGERBUFFERSIZE];
+  char streamBuffer[MAXSTREAMBUFFERSIZE];
+  uint8_t bufferIndex = 0;
+  uint8_t messageState = kProccesingMessage;
+  char cmdLastChar = '\0';
+  char argLastChar = '\0';
+  char* current = nullptr;
+  char* last = nullptr;
+  bool dumped = true;
+  bool argOk = false;
+  int lastCommandId = -1;
+};
+
+#endif
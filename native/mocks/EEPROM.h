@@ -0,0 +1,56 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : EEPROM stand-in for the native build. Like the
+*                     AVR, a write starts the 3.3 ms cell write and
+*                     returns; the next access waits until it is done.
+*                     Wear is counted per cell.
+*
+*/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <Arduino.h>
+#include "Hardware.h"
+
+// avr/eeprom.h: no cell write in progress
+inline bool eeprom_is_ready() {
+  return hw::now() >= hw::eeprom.busyUntil;
+}
+
+class EEPROMClass {
+public:
+  uint8_t read(int address) {
+    waitReady();
+    hw::advance(hw::cost::eepromRead);
+    return hw::eeprom.cells[address % hw::Eeprom::size];
+  }
+  void write(int address, uint8_t value) {
+    address %= hw::Eeprom::size;
+    waitReady();
+    hw::advance(hw::cost::eepromRead);
+    hw::eeprom.busyUntil = hw::now() + hw::cost::eepromWrite;
+    hw::eeprom.cells[address] = value;
+    hw::eeprom.wear[address]++;
+    hw::eeprom.writes++;
+  }
+  void update(int address, uint8_t value) {
+    if (read(address) != value) {
+      write(address, value);
+    }
+  }
+  uint16_t length() { return hw::Eeprom::size; }
+
+private:
+  void waitReady() {
+    if (!eeprom_is_ready()) {
+      hw::advance(hw::eeprom.busyUntil - hw::now());
+    }
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,58 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : EncoderButton stand-in for the native build.
+*
+*/
+
+#include "EncoderButton.h"
+#include "Hardware.h"
+
+EncoderButton* EncoderButton::first = nullptr;
+
+// Pins are not simulated, the bench uses the simulate calls
+EncoderButton::EncoderButton(byte, byte, byte) {
+  if (!first) {
+    first = this;
+  }
+}
+
+EncoderButton::EncoderButton(byte) {
+  if (!first) {
+    first = this;
+  }
+}
+
+void EncoderButton::update() {
+  // Library cost: debounce and encoder reads on each call
+  hw::advance(3 * hw::cost::digitalRead);
+
+  if (queuedSteps != 0) {
+    delivered = queuedSteps;
+    pos += queuedSteps;
+    queuedSteps = 0;
+    if (onEncoder) {
+      onEncoder(*this);
+    }
+  }
+  if (queuedLong) {
+    queuedLong = false;
+    if (onLongPress) {
+      onLongPress(*this);
+    }
+  }
+  if (queuedClicks) {
+    uint8_t clicks = queuedClicks;
+    queuedClicks = 0;
+    if (clicks == 1 && onClick) {
+      onClick(*this);
+    }
+    if (clicks == 2 && onDoubleClick) {
+      onDoubleClick(*this);
+    }
+    if (clicks == 3 && onTripleClick) {
+      onTripleClick(*this);
+    }
+  }
+}
@@ -0,0 +1,58 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : EncoderButton stand-in for the native build.
+*                     The harness queues turns and clicks, update()
+*                     delivers them to the handlers like the library.
+*
+*/
+
+#ifndef ENCODER_BUTTON_H
+#define ENCODER_BUTTON_H
+
+#include <Arduino.h>
+
+class EncoderButton {
+public:
+  typedef void (*CallbackFunction)(EncoderButton&);
+
+  EncoderButton(byte encoderPin1, byte encoderPin2, byte switchPin);
+  explicit EncoderButton(byte switchPin);
+
+  void update();
+  int increment() { return delivered; }
+  long position() { return pos; }
+
+  void setLongClickDuration(unsigned int ms) { longClickMs = ms; }
+  void setClickHandler(CallbackFunction f) { onClick = f; }
+  void setEncoderHandler(CallbackFunction f) { onEncoder = f; }
+  void setLongPressHandler(CallbackFunction f) { onLongPress = f; }
+  void setDoubleClickHandler(CallbackFunction f) { onDoubleClick = f; }
+  void setTripleClickHandler(CallbackFunction f) { onTripleClick = f; }
+  void setUserId(int id) { user = id; }
+  int userId() { return user; }
+
+  // ----- Harness side -----
+  void simulateTurn(int steps) { queuedSteps += steps; }
+  void simulateClicks(uint8_t count) { queuedClicks = count; }
+  void simulateLongPress() { queuedLong = true; }
+
+  static EncoderButton* first;          // First instance, for the harness
+
+private:
+  CallbackFunction onClick = nullptr;
+  CallbackFunction onEncoder = nullptr;
+  CallbackFunction onLongPress = nullptr;
+  CallbackFunction onDoubleClick = nullptr;
+  CallbackFunction onTripleClick = nullptr;
+  unsigned int longClickMs = 750;
+  int user = 0;
+  int queuedSteps = 0;
+  int delivered = 0;
+  long pos = 0;
+  uint8_t queuedClicks = 0;
+  bool queuedLong = false;
+};
+
+#endif
@@ -0,0 +1,524 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Hardware model and Arduino core for the native build.
+*
+*/
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "Hardware.h"
+
+EEPROMClass EEPROM;
+
+namespace hw {
+
+// -------------------------------- Virtual clock ------------------------------------
+
+static uint64_t clockUs = 0;
+
+struct InputEvent {
+  uint64_t time;
+  uint8_t pin;
+  uint8_t level;
+};
+static std::deque<InputEvent> inputEvents;      // Sorted by time
+static bool inInterrupt = false;
+
+uint64_t now() {
+  return clockUs;
+}
+
+// Inputs due within the advanced time are applied at their own time, so an ISR
+// runs and reads micros() in the middle of whatever the firmware was doing.
+void advance(uint64_t us) {
+  uint64_t target = clockUs + us;
+  while (!inInterrupt && !inputEvents.empty() && inputEvents.front().time <= target) {
+    InputEvent e = inputEvents.front();
+    inputEvents.pop_front();
+    if (e.time > clockUs) {
+      clockUs = e.time;
+    }
+    uint64_t before = clockUs;
+    inInterrupt = true;
+    setInput(e.pin, e.level);
+    inInterrupt = false;
+    // Time spent in the ISR is taken from the interrupted code
+    target += clockUs - before;
+  }
+  if (target > clockUs) {
+    clockUs = target;
+  }
+}
+
+void scheduleInput(uint64_t at, uint8_t pin, uint8_t level) {
+  InputEvent e = { at, pin, level };
+  auto it = inputEvents.end();
+  while (it != inputEvents.begin() && (it - 1)->time > at) {
+    --it;
+  }
+  inputEvents.insert(it, e);
+}
+
+uint64_t nextExternalEvent() {
+  uint64_t next = UINT64_MAX;
+  if (!inputEvents.empty()) {
+    next = inputEvents.front().time;
+  }
+  if (!uart.incoming.empty() && uart.incoming.front().time < next) {
+    next = uart.incoming.front().time;
+  }
+  return next;
+}
+
+void reset() {
+  clockUs = 0;
+  inputEvents.clear();
+}
+
+// ------------------------------------- Pins ----------------------------------------
+
+static uint8_t levels[NUM_DIGITAL_PINS];
+static uint8_t modes[NUM_DIGITAL_PINS];
+static void (*isrs[2])(void);
+static int isrModes[2];
+static bool interruptsOn = true;
+static bool isrPending[2];
+
+static void fireInterrupt(uint8_t num) {
+  if (!isrs[num]) {
+    return;
+  }
+  if (!interruptsOn) {
+    isrPending[num] = true;
+    return;
+  }
+  isrs[num]();
+}
+
+uint8_t pinLevel(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? levels[pin] : LOW;
+}
+
+void setInput(uint8_t pin, uint8_t level) {
+  if (pin >= NUM_DIGITAL_PINS || levels[pin] == level) {
+    return;
+  }
+  levels[pin] = level;
+  int num = digitalPinToInterrupt(pin);
+  if (num < 0) {
+    return;
+  }
+  int mode = isrModes[num];
+  if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) {
+    fireInterrupt(num);
+  }
+}
+
+// ------------------------------------ HD44780 --------------------------------------
+
+Hd44780 lcd;
+
+Hd44780::Hd44780() {
+  memset(ddram, ' ', sizeof(ddram));
+  memset(cgram, 0, sizeof(cgram));
+}
+
+void Hd44780::onPinWrite(uint8_t pin, uint8_t level) {
+  // Data is latched on the falling edge of E
+  if (pin != en || level != LOW || levels[en] != HIGH) {
+    return;
+  }
+  uint8_t nibble = (levels[d4] ? 1 : 0) | (levels[d5] ? 2 : 0) | (levels[d6] ? 4 : 0) | (levels[d7] ? 8 : 0);
+  bool isData = levels[rs];
+
+  if (!fourBit) {
+    // 8-bit mode during init, D0..D3 are not wired and read as 0.
+    // Function set with DL=0 switches to 4-bit.
+    if (!isData && nibble == 0x02) {
+      fourBit = true;
+      highNibble = true;
+    }
+    return;
+  }
+  if (highNibble) {
+    if (clockUs < busyUntil) {
+      violations++;
+    }
+    latched = nibble << 4;
+    latchedRs = isData;
+    highNibble = false;
+    return;
+  }
+  highNibble = true;
+  execute(latched | nibble, latchedRs);
+}
+
+void Hd44780::execute(uint8_t value, bool isData) {
+  bytes++;
+  busyUntil = clockUs + 37;
+  if (isData) {
+    dataBytes++;
+    if (cgramMode) {
+      cgram[address & 0x3F] = value;
+    } else {
+      if (ddram[address & 0x7F] != value) {
+        lastChange = clockUs;
+      }
+      ddram[address & 0x7F] = value;
+    }
+    address++;
+    return;
+  }
+  if (value & 0x80) {                 // Set DDRAM address
+    address = value & 0x7F;
+    cgramMode = false;
+  } else if (value & 0x40) {          // Set CGRAM address
+    address = value & 0x3F;
+    cgramMode = true;
+  } else if (value & 0x08 && !(value & 0xF0)) {   // Display control
+    cursorOn = value & 0x02;
+  } else if (value == 0x01) {         // Clear
+    memset(ddram, ' ', sizeof(ddram));
+    address = 0;
+    cgramMode = false;
+    clears++;
+    lastChange = clockUs;
+    busyUntil = clockUs + 1520;
+  } else if ((value & 0xFE) == 0x02) {  // Home
+    address = 0;
+    busyUntil = clockUs + 1520;
+  }
+}
+
+std::string Hd44780::row(uint8_t r) const {
+  std::string s;
+  for (uint8_t c = 0; c < 16; c++) {
+    uint8_t ch = ddram[(r ? 0x40 : 0x00) + c];
+    s += ch < 8 ? '#' : (char)ch;
+  }
+  return s;
+}
+
+uint8_t Hd44780::cursorCol() const {
+  return address & 0x3F;
+}
+
+uint8_t Hd44780::cursorRow() const {
+  return (address & 0x40) ? 1 : 0;
+}
+
+// ------------------------------------- UART ----------------------------------------
+
+Uart uart;
+
+uint32_t Uart::byteTime() const {
+  return baud ? (10000000UL + baud - 1) / baud : 0;
+}
+
+void Uart::hostSend(const std::string& bytes, uint64_t at, unsigned long rate) {
+  uint32_t bt = rate ? (10000000UL + rate - 1) / rate : byteTime() ? byteTime() : 87;
+  uint64_t t = at > rxWireFree ? at : rxWireFree;
+  for (size_t i = 0; i < bytes.size(); i++) {
+    t += bt;
+    incoming.push_back(WireByte{t, (uint8_t)bytes[i], rate});
+  }
+  rxWireFree = t;
+}
+
+uint8_t Uart::noise(uint8_t c, uint32_t& counter, uint32_t& flipped) const {
+  if (noiseEvery == 0 || ++counter < noiseEvery) {
+    return c;
+  }
+  counter = 0;
+  flipped++;
+  return c ^ 0x04;
+}
+
+void Uart::pump() {
+  while (!incoming.empty() && incoming.front().time <= clockUs) {
+    if (baud == 0) {
+      // Port closed, bytes are lost
+    } else if (rx.size() < bufferSize - 1) {
+      WireByte b = incoming.front();
+      b.value = b.baud && b.baud != baud ? 0xFF : noise(b.value, noiseInCount, noisyIn);
+      b.baud = 0;
+      rx.push_back(b);
+      bytesIn++;
+    } else {
+      rxOverflows++;
+    }
+    incoming.pop_front();
+  }
+}
+
+int Uart::txQueued() const {
+  if (txWireFree <= clockUs || byteTime() == 0) {
+    return 0;
+  }
+  return (int)((txWireFree - clockUs + byteTime() - 1) / byteTime());
+}
+
+void Uart::write(uint8_t c) {
+  if (baud == 0) {
+    return;
+  }
+  // Wait for room in the TX buffer
+  int queued = txQueued();
+  if (queued >= (int)bufferSize - 1) {
+    uint64_t wait = txWireFree - (uint64_t)(bufferSize - 2) * byteTime() - clockUs;
+    txStallUs += wait;
+    advance(wait);
+  }
+  uint64_t start = txWireFree > clockUs ? txWireFree : clockUs;
+  txWireFree = start + byteTime();
+  txLog.push_back(WireByte{txWireFree, noise(c, noiseOutCount, noisyOut), baud});
+  bytesOut++;
+}
+
+uint64_t Uart::takeArrival(uint8_t value) {
+  while (!readArrivals.empty()) {
+    WireByte b = readArrivals.front();
+    readArrivals.pop_front();
+    if (b.value == value) {
+      return b.time;
+    }
+  }
+  return clockUs;
+}
+
+// ------------------------------------ EEPROM ---------------------------------------
+
+Eeprom eeprom;
+
+Eeprom::Eeprom() {
+  memset(cells, 0xFF, sizeof(cells));
+  memset(wear, 0, sizeof(wear));
+}
+
+Heap heap;
+uint64_t commandsDispatched = 0;
+void (*onDispatch)(uint64_t arrivedUs, uint64_t doneUs) = nullptr;
+
+}
+
+// =============================== Arduino core API ===================================
+
+using namespace hw;
+
+unsigned long millis() {
+  advance(cost::clockRead);
+  return (unsigned long)(clockUs / 1000);
+}
+
+unsigned long micros() {
+  advance(cost::clockRead);
+  return (unsigned long)clockUs;
+}
+
+void delay(unsigned long ms) {
+  advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  advance(cost::pinMode);
+  if (pin < NUM_DIGITAL_PINS) {
+    modes[pin] = mode;
+    if (mode == INPUT_PULLUP) {
+      levels[pin] = HIGH;
+    }
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  advance(cost::digitalWrite);
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  value = value ? HIGH : LOW;
+  lcd.onPinWrite(pin, value);
+  levels[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+  advance(cost::digitalRead);
+  return pinLevel(pin);
+}
+
+void analogWrite(uint8_t pin, int value) {
+  advance(cost::analogWrite);
+  if (pin < NUM_DIGITAL_PINS) {
+    levels[pin] = value > 127 ? HIGH : LOW;
+  }
+}
+
+void attachInterrupt(uint8_t num, void (*isr)(void), int mode) {
+  if (num < 2) {
+    isrs[num] = isr;
+    isrModes[num] = mode;
+  }
+}
+
+void detachInterrupt(uint8_t num) {
+  if (num < 2) {
+    isrs[num] = nullptr;
+  }
+}
+
+void noInterrupts() {
+  interruptsOn = false;
+}
+
+void interrupts() {
+  interruptsOn = true;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (isrPending[i]) {
+      isrPending[i] = false;
+      fireInterrupt(i);
+    }
+  }
+}
+
+// ------------------------------------- String --------------------------------------
+
+String::String(const char* s) : buf(nullptr), len(0) {
+  assign(s);
+}
+
+String::String(const String& other) : buf(nullptr), len(0) {
+  assign(other.buf);
+}
+
+String::~String() {
+  release();
+}
+
+String& String::operator=(const String& other) {
+  if (this != &other) {
+    assign(other.buf);
+  }
+  return *this;
+}
+
+void String::assign(const char* s) {
+  if (!s) {
+    s = "";
+  }
+  release();
+  len = strlen(s);
+  buf = new char[len + 1];
+  heap.allocs++;
+  heap.liveBytes += len + 1;
+  memcpy(buf, s, len + 1);
+}
+
+void String::release() {
+  if (buf) {
+    heap.frees++;
+    heap.liveBytes -= len + 1;
+    delete[] buf;
+    buf = nullptr;
+  }
+}
+
+// ----------------------------------- Print / Stream --------------------------------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    return print('-') + printNumber(-(unsigned long)n, DEC);
+  }
+  return printNumber((unsigned long)n, base);
+}
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length && available()) {
+    buffer[count++] = (char)read();
+  }
+  return count;
+}
+
+// ------------------------------------ Serial ---------------------------------------
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+  uart.baud = baud;
+}
+
+void HardwareSerial::end() {
+  flush();
+  uart.baud = 0;
+  uart.rx.clear();
+  uart.readArrivals.clear();
+}
+
+int HardwareSerial::available() {
+  uart.pump();
+  return (int)uart.rx.size();
+}
+
+int HardwareSerial::read() {
+  uart.pump();
+  if (uart.rx.empty()) {
+    return -1;
+  }
+  WireByte b = uart.rx.front();
+  uart.rx.pop_front();
+  uart.readArrivals.push_back(b);
+  return b.value;
+}
+
+int HardwareSerial::peek() {
+  uart.pump();
+  return uart.rx.empty() ? -1 : uart.rx.front().value;
+}
+
+int HardwareSerial::availableForWrite() {
+  return (int)Uart::bufferSize - 1 - uart.txQueued();
+}
+
+void HardwareSerial::flush() {
+  if (uart.txWireFree > clockUs) {
+    advance(uart.txWireFree - clockUs);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  uart.write(c);
+  return 1;
+}
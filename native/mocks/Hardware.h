@@ -0,0 +1,172 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Hardware model behind the native Arduino stand-in.
+*                     A virtual clock in microseconds, pin levels with
+*                     pin interrupts, an HD44780 decoding the real pin
+*                     traffic and a UART with the Uno buffer sizes.
+*
+*/
+
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace hw {
+
+// ------------------------------------ Costs ----------------------------------------
+// Approximate ATmega328 @ 16 MHz timings, in microseconds
+
+namespace cost {
+  const uint32_t digitalWrite = 4;      // Arduino digitalWrite() with pin lookup
+  const uint32_t digitalRead = 4;
+  const uint32_t pinMode = 4;
+  const uint32_t analogWrite = 6;
+  const uint32_t clockRead = 2;         // millis() / micros(), so busy waits make progress
+  const uint32_t eepromRead = 1;
+  const uint32_t eepromWrite = 3300;    // Cell write, in the background until the next access
+  const uint32_t parseByte = 3;         // CmdMessenger per received byte
+  const uint32_t dispatch = 20;         // CmdMessenger command lookup and callback call
+  const uint32_t loopBase = 10;         // Bare loop() pass with nothing to do
+}
+
+// -------------------------------- Virtual clock ------------------------------------
+
+uint64_t now();
+void advance(uint64_t us);
+void reset();
+
+// ------------------------------------- Pins ----------------------------------------
+
+uint8_t pinLevel(uint8_t pin);
+// Drive an input pin from outside (encoder, button). Fires attached interrupts.
+void setInput(uint8_t pin, uint8_t level);
+// Same, at a given time. The change is applied when the clock passes that time, even
+// in the middle of a long blocking call, so interrupts see it when it happens.
+void scheduleInput(uint64_t at, uint8_t pin, uint8_t level);
+// Time of the next scheduled input or inbound byte, UINT64_MAX when nothing is due
+uint64_t nextExternalEvent();
+
+// ------------------------------------ HD44780 --------------------------------------
+// Decodes RS/E/D4..D7 writes like the controller does, including the 8-bit to 4-bit
+// init sequence, and counts bytes sent before the previous instruction finished.
+
+struct Hd44780 {
+  uint8_t rs = 19, en = 18, d4 = 17, d5 = 16, d6 = 15, d7 = 14;   // A5..A0
+
+  uint8_t ddram[0x80];
+  uint8_t cgram[64];
+  uint8_t address = 0;
+  bool cgramMode = false;
+  bool fourBit = false;
+  bool highNibble = true;
+  uint8_t latched = 0;
+  bool latchedRs = false;
+  bool cursorOn = false;
+  uint64_t busyUntil = 0;
+
+  uint32_t bytes = 0;           // Instructions + data bytes received
+  uint32_t dataBytes = 0;
+  uint32_t clears = 0;
+  uint32_t violations = 0;      // Bytes sent while the controller was busy
+  uint64_t lastChange = 0;      // Time of the last DDRAM change
+
+  Hd44780();
+  void onPinWrite(uint8_t pin, uint8_t level);
+  std::string row(uint8_t r) const;       // Row text, custom glyphs shown as '#'
+  uint8_t cursorCol() const;
+  uint8_t cursorRow() const;
+
+private:
+  void execute(uint8_t value, bool isData);
+};
+
+extern Hd44780 lcd;
+
+// ------------------------------------- UART ----------------------------------------
+// RX: bytes injected by the host arrive one byte time apart and land in the 64 byte
+// RX buffer; overflow drops them. TX: bytes leave one byte time apart; a full 64 byte
+// TX buffer makes write() wait, exactly like HardwareSerial.
+// Each byte carries the rate it was sent at: a receiver at another rate gets 0xFF, a
+// framing error. noiseEvery flips a bit of every n-th byte, each direction counted apart.
+
+struct WireByte {
+  uint64_t time;                // Arrival (RX) or end of transmission (TX)
+  uint8_t value;
+  unsigned long baud;           // Sent at, 0 when at the rate of the receiver
+};
+
+struct Uart {
+  static const unsigned bufferSize = 64;
+
+  unsigned long baud = 0;
+  std::deque<WireByte> incoming;        // Host to board, not arrived yet
+  std::deque<WireByte> rx;              // RX buffer, with the arrival time of each byte
+  std::deque<WireByte> readArrivals;    // Bytes read with their arrival time, see takeArrival()
+  std::deque<WireByte> txLog;           // Board to host, collected by the harness
+  uint64_t rxWireFree = 0;              // When the host side wire is free again
+  uint64_t txWireFree = 0;              // When the last queued TX byte is on the wire
+
+  uint32_t rxOverflows = 0;
+  uint64_t bytesIn = 0;
+  uint64_t bytesOut = 0;
+  uint64_t txStallUs = 0;               // Time write() waited for TX buffer space
+  uint32_t noiseEvery = 0;              // 0: no noise
+  uint32_t noisyIn = 0;                 // Bytes flipped on the way to the board
+  uint32_t noisyOut = 0;                // And to the host
+  uint32_t noiseInCount = 0;
+  uint32_t noiseOutCount = 0;
+
+  uint32_t byteTime() const;            // 10 bits per byte
+  // Host bytes sent at baud, 0 for whatever rate the board has
+  void hostSend(const std::string& bytes, uint64_t at, unsigned long baud = 0);
+  uint8_t noise(uint8_t c, uint32_t& counter, uint32_t& flipped) const;
+  void pump();                          // Move arrived bytes into the RX buffer
+  int txQueued() const;                 // Bytes in the TX buffer
+  void write(uint8_t c);
+  // Arrival time of the oldest byte read with this value and not taken yet, the older
+  // ones are skipped: bytes the firmware read and did not pass to CmdMessenger (a frame
+  // trailer, a rejected frame). The CmdMessenger stand-in takes one per byte it parses.
+  uint64_t takeArrival(uint8_t value);
+};
+
+extern Uart uart;
+
+// ------------------------------------ EEPROM ---------------------------------------
+
+struct Eeprom {
+  static const unsigned size = 1024;
+  uint8_t cells[size];
+  uint32_t wear[size];
+  uint32_t writes = 0;
+  uint64_t busyUntil = 0;       // End of the cell write in progress
+  Eeprom();
+};
+
+extern Eeprom eeprom;
+
+// ------------------------------------- Heap ----------------------------------------
+// Allocations by the Arduino String, the only heap user the firmware can reach
+
+struct Heap {
+  uint64_t allocs = 0;
+  uint64_t frees = 0;
+  int64_t liveBytes = 0;
+};
+
+extern Heap heap;
+
+// ------------------------------------ Counters -------------------------------------
+
+extern uint64_t commandsDispatched;     // Inbound commands handed to a callback
+// Called after each dispatched command with the arrival of its ';' and the end of its callback
+extern void (*onDispatch)(uint64_t arrivedUs, uint64_t doneUs);
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Non-blocking HD44780 driver, 4-bit mode.
+*
+*/
+
+#include "AsyncLcd.h"
+
+// ------------------------------ HD44780 commands ---------------------------------
+#define LCD_CLEARDISPLAY    0x01
+#define LCD_ENTRYMODESET    0x04
+#define LCD_DISPLAYCONTROL  0x08
+#define LCD_FUNCTIONSET     0x20
+#define LCD_SETCGRAMADDR    0x40
+#define LCD_SETDDRAMADDR    0x80
+
+#define LCD_ENTRYLEFT       0x02
+#define LCD_DISPLAYON       0x04
+#define LCD_CURSORON        0x02
+#define LCD_2LINE           0x08
+
+// Execution times from the datasheet, with some margin
+#define LCD_EXEC_US         40
+#define LCD_CLEAR_US        2000
+
+AsyncLcd::AsyncLcd(uint8_t rs, uint8_t en, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7) {
+  rsPin = rs;
+  enPin = en;
+  dataPins[0] = d4;
+  dataPins[1] = d5;
+  dataPins[2] = d6;
+  dataPins[3] = d7;
+  displayControl = LCD_DISPLAYON;
+  head = 0;
+  count = 0;
+  readyAt = 0;
+}
+
+// ------------------------------------ Setup ---------------------------------------
+
+void AsyncLcd::begin(uint8_t /* cols */, uint8_t rows) {
+  pinMode(rsPin, OUTPUT);
+  pinMode(enPin, OUTPUT);
+  for (uint8_t i = 0; i < 4; i++) {
+    pinMode(dataPins[i], OUTPUT);
+  }
+
+  // Power-on: wait for Vcc to rise, then force 4-bit mode (datasheet figure 24)
+  delayMicroseconds(50000);
+  digitalWrite(rsPin, LOW);
+  digitalWrite(enPin, LOW);
+  write4bits(0x03);
+  delayMicroseconds(4500);
+  write4bits(0x03);
+  delayMicroseconds(4500);
+  write4bits(0x03);
+  delayMicroseconds(150);
+  write4bits(0x02);
+  delayMicroseconds(LCD_EXEC_US);
+
+  command(LCD_FUNCTIONSET | (rows > 1 ? LCD_2LINE : 0));
+  command(LCD_DISPLAYCONTROL | displayControl);
+  clear();
+  command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+  waitRoom(kQueueSize);
+}
+
+void AsyncLcd::createChar_P(uint8_t location, const uint8_t charmap[8]) {
+  waitRoom(9);
+  push(LCD_SETCGRAMADDR | ((location & 0x07) << 3), false);
+  for (uint8_t i = 0; i < 8; i++) {
+    push(pgm_read_byte(&charmap[i]), true);
+  }
+}
+
+// ----------------------------------- Queued ---------------------------------------
+
+void AsyncLcd::clear() {
+  push(LCD_CLEARDISPLAY, false);
+}
+
+void AsyncLcd::cursor() {
+  displayControl |= LCD_CURSORON;
+  push(LCD_DISPLAYCONTROL | displayControl, false);
+}
+
+void AsyncLcd::noCursor() {
+  displayControl &= ~LCD_CURSORON;
+  push(LCD_DISPLAYCONTROL | displayControl, false);
+}
+
+void AsyncLcd::setCursor(uint8_t col, uint8_t row) {
+  push(LCD_SETDDRAMADDR | (col + (row ? 0x40 : 0x00)), false);
+}
+
+void AsyncLcd::command(uint8_t value) {
+  push(value, false);
+}
+
+size_t AsyncLcd::write(uint8_t value) {
+  return push(value, true) ? 1 : 0;
+}
+
+bool AsyncLcd::push(uint8_t value, bool data) {
+  if (count == kQueueSize) {
+    return false;
+  }
+  uint8_t tail = (head + count) % kQueueSize;
+  queue[tail] = value;
+  if (data) {
+    isData[tail >> 3] |= (1 << (tail & 7));
+  } else {
+    isData[tail >> 3] &= ~(1 << (tail & 7));
+  }
+  count++;
+  return true;
+}
+
+// ---------------------------------- Service --------------------------------------
+
+uint8_t AsyncLcd::service(uint8_t maxBytes) {
+  uint8_t sent = 0;
+  while (sent < maxBytes && count > 0 && (long)(micros() - readyAt) >= 0) {
+    bool data = isData[head >> 3] & (1 << (head & 7));
+    send(queue[head], data);
+    head = (head + 1) % kQueueSize;
+    count--;
+    sent++;
+  }
+  return sent;
+}
+
+// Setup only: send queued bytes until there is room for the given number of entries
+void AsyncLcd::waitRoom(uint8_t entries) {
+  while (room() < entries) {
+    service(kQueueSize);
+  }
+}
+
+// ----------------------------------- Bus I/O -------------------------------------
+
+void AsyncLcd::send(uint8_t value, bool data) {
+  digitalWrite(rsPin, data ? HIGH : LOW);
+  write4bits(value >> 4);
+  write4bits(value);
+  // Clear and home are the only slow instructions
+  bool slow = !data && value <= 0x03;
+  readyAt = micros() + (slow ? LCD_CLEAR_US : LCD_EXEC_US);
+}
+
+void AsyncLcd::write4bits(uint8_t value) {
+  for (uint8_t i = 0; i < 4; i++) {
+    digitalWrite(dataPins[i], (value >> i) & 0x01);
+  }
+  pulseEnable();
+}
+
+void AsyncLcd::pulseEnable() {
+  // Enable pulse must be >450 ns wide
+  digitalWrite(enPin, HIGH);
+  delayMicroseconds(1);
+  digitalWrite(enPin, LOW);
+}
@@ -0,0 +1,67 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Fixed-point helpers.
+*
+*/
+
+#include "FixedPoint.h"
+
+// ------------------------------------ Parse --------------------------------------
+
+long parseFixed(const char* s, uint8_t decimals) {
+  bool negative = false;
+  if (*s == '-') {
+    negative = true;
+    s++;
+  }
+
+  long value = 0;
+  while (*s >= '0' && *s <= '9') {
+    value = value * 10 + (*s++ - '0');
+  }
+
+  uint8_t fraction = 0;
+  if (*s == '.') {
+    s++;
+    while (fraction < decimals && *s >= '0' && *s <= '9') {
+      value = value * 10 + (*s++ - '0');
+      fraction++;
+    }
+    // Round on the first dropped digit
+    if (*s >= '5' && *s <= '9') {
+      value++;
+    }
+  }
+  for (; fraction < decimals; fraction++) {
+    value *= 10;
+  }
+  return negative ? -value : value;
+}
+
+// ------------------------------------ Print --------------------------------------
+
+void printFixed(Print& out, long value, uint8_t width, uint8_t decimals, char pad) {
+  char buf[14];
+  uint8_t i = sizeof(buf);
+  bool negative = value < 0;
+  unsigned long v = negative ? -value : value;
+
+  // Digits from the right, with at least one integer digit before the point
+  do {
+    if (decimals > 0 && sizeof(buf) - i == decimals) {
+      buf[--i] = '.';
+    }
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while (v > 0 || sizeof(buf) - i <= decimals);
+  if (negative) {
+    buf[--i] = '-';
+  }
+
+  for (uint8_t len = sizeof(buf) - i; len < width; len++) {
+    out.write(pad);
+  }
+  out.write((const uint8_t*)buf + i, sizeof(buf) - i);
+}
@@ -0,0 +1,41 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : 2x16 shadow framebuffer for the HD44780 display.
+*
+*/
+
+#include "LcdFrameBuffer.h"
+
+LcdFrameBuffer::LcdFrameBuffer() {
+  clear();
+  memset(shown, ' ', sizeof(shown));
+  shownCol = 0;
+  shownRow = 0;
+  stale = true;
+}
+
+void LcdFrameBuffer::clear() {
+  memset(back, ' ', sizeof(back));
+  col = 0;
+  row = 0;
+}
+
+void LcdFrameBuffer::setCursor(uint8_t c, uint8_t r) {
+  col = c;
+  row = r;
+}
+
+void LcdFrameBuffer::invalidate() {
+  stale = true;
+}
+
+size_t LcdFrameBuffer::write(uint8_t c) {
+  // Characters past the right edge are dropped, like on the panel itself
+  if (row < kRows && col < kCols) {
+    back[row][col] = c;
+  }
+  col++;
+  return 1;
+}
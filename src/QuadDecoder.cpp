@@ -0,0 +1,107 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Interrupt driven quadrature decoder.
+*
+*/
+
+#include "QuadDecoder.h"
+
+QuadDecoder* QuadDecoder::instances[kMaxDecoders];
+uint8_t QuadDecoder::instanceCount = 0;
+void (* const QuadDecoder::handlers[kMaxDecoders])() = {
+  onPinChange<0>, onPinChange<1>, onPinChange<2>, onPinChange<3>
+};
+
+// Quarter step for each transition, indexed by old state | new state << 2.
+// Same direction convention as the Encoder library behind EncoderButton.
+// Both pins changing at once is a glitch or a missed edge and counts nothing.
+static const int8_t transitions[16] PROGMEM = {
+   0, +1, -1,  0,
+  -1,  0,  0, +1,
+  +1,  0,  0, -1,
+   0, -1, +1,  0
+};
+
+// The ring entries are not volatile: keeps the compiler from moving their stores and loads
+// across the volatile head / tail updates
+static inline void compilerBarrier() {
+  asm volatile("" ::: "memory");
+}
+
+QuadDecoder::QuadDecoder(uint8_t a, uint8_t b)
+  : pinA(a), pinB(b), state(3), quarters(0), head(0), tail(0), overflowCount(0) {
+}
+
+bool QuadDecoder::begin() {
+  if (instanceCount == kMaxDecoders) {
+    return false;
+  }
+  uint8_t slot = instanceCount++;
+  instances[slot] = this;
+  pinMode(pinA, INPUT_PULLUP);
+  pinMode(pinB, INPUT_PULLUP);
+  state = digitalRead(pinA) | (digitalRead(pinB) << 1);
+  attachInterrupt(digitalPinToInterrupt(pinA), handlers[slot], CHANGE);
+  attachInterrupt(digitalPinToInterrupt(pinB), handlers[slot], CHANGE);
+  return true;
+}
+
+// ------------------------------------- ISR ---------------------------------------
+
+template <uint8_t slot>
+void QuadDecoder::onPinChange() {
+  instances[slot]->decode();
+}
+
+void QuadDecoder::decode() {
+  uint8_t now = digitalRead(pinA) | (digitalRead(pinB) << 1);
+  quarters += (int8_t)pgm_read_byte(&transitions[state | (now << 2)]);
+  state = now;
+  // A detent is the resting state with both pins pulled up. Half a cycle in one
+  // direction is enough, so one lost edge does not lose the step, while contact
+  // bounce on one pin adds up to nothing.
+  if (now != 3) {
+    return;
+  }
+  int8_t dir = 0;
+  if (quarters >= 2) {
+    dir = 1;
+  } else if (quarters <= -2) {
+    dir = -1;
+  }
+  quarters = 0;
+  if (dir == 0) {
+    return;
+  }
+  uint8_t next = (head + 1) & (kRingSize - 1);
+  if (next == tail) {
+    overflowCount++;
+    return;
+  }
+  ring[head].us = micros();
+  ring[head].dir = dir;
+  compilerBarrier();
+  head = next;
+}
+
+// ------------------------------------- Loop --------------------------------------
+
+bool QuadDecoder::read(EncoderStep& step) {
+  if (tail == head) {
+    return false;
+  }
+  compilerBarrier();
+  step = ring[tail];
+  compilerBarrier();
+  tail = (tail + 1) & (kRingSize - 1);
+  return true;
+}
+
+uint16_t QuadDecoder::overflows() {
+  noInterrupts();
+  uint16_t count = overflowCount;
+  interrupts();
+  return count;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Free RAM and stack high-water mark.
+*
+*/
+
+#include "RamMonitor.h"
+
+#if defined(__AVR__)
+
+// From the linker and malloc(): the start of the heap, its end once something was allocated
+extern char __heap_start;
+extern char* __brkval;
+
+static const uint8_t kPaint = 0xC5;
+
+static uint8_t* heapEnd() {
+  return (uint8_t*)(__brkval ? __brkval : &__heap_start);
+}
+
+// Below SP nothing is in use. An interrupt during the loop leaves its frame unpainted,
+// which is right: that RAM was used.
+void paintRam() {
+  for (uint8_t* p = heapEnd(); p < (uint8_t*)SP; p++) {
+    *p = kPaint;
+  }
+}
+
+uint16_t freeRam() {
+  return (uint8_t*)SP - heapEnd();
+}
+
+// The stack grows down from the top: the paint left at the bottom was never reached
+uint16_t ramHeadroom() {
+  uint16_t count = 0;
+  for (const uint8_t* p = heapEnd(); p < (uint8_t*)SP && *p == kPaint; p++) {
+    count++;
+  }
+  return count;
+}
+
+#else
+
+void paintRam() {
+}
+
+uint16_t freeRam() {
+  return kRamUnknown;
+}
+
+uint16_t ramHeadroom() {
+  return kRamUnknown;
+}
+
+#endif
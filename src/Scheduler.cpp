@@ -0,0 +1,50 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Cooperative loop() scheduler.
+*
+*/
+
+#include "Scheduler.h"
+
+Scheduler::Scheduler(Task* taskList, uint8_t taskCount, uint16_t bound)
+  : tasks(taskList), count(taskCount), boundUs(bound), urgentUs(0) {
+}
+
+void Scheduler::run() {
+  runTask(tasks[0]);
+  for (uint8_t i = 1; i < count; i++) {
+    if (micros() - urgentUs >= boundUs) {
+      runTask(tasks[0]);
+    }
+    runTask(tasks[i]);
+  }
+}
+
+void Scheduler::runTask(Task& task) {
+  unsigned long start = micros();
+  task.run();
+  unsigned long end = micros();
+  unsigned long took = end - start;
+  if (&task == &tasks[0]) {
+    urgentUs = end;
+  }
+  if (task.runs != 0xFFFF) {
+    task.runs++;
+  }
+  if (took > task.budgetUs && task.overruns != 0xFFFF) {
+    task.overruns++;
+  }
+  if (took > task.longest) {
+    task.longest = took > 0xFFFF ? 0xFFFF : took;
+  }
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < count; i++) {
+    tasks[i].runs = 0;
+    tasks[i].overruns = 0;
+    tasks[i].longest = 0;
+  }
+}
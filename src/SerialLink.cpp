@@ -0,0 +1,419 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Outbound frame queue for the serial port.
+*
+*/
+
+#include "SerialLink.h"
+
+// CRC-8, polynomial 0x07: the CRC of each high nibble, two lookups per byte
+static const uint8_t crcNibbles[16] PROGMEM = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+static uint8_t crc8(uint8_t crc, uint8_t c) {
+  crc ^= c;
+  crc = (crc << 4) ^ pgm_read_byte(&crcNibbles[crc >> 4]);
+  crc = (crc << 4) ^ pgm_read_byte(&crcNibbles[crc >> 4]);
+  return crc;
+}
+
+static uint8_t hexDigit(uint8_t v) {
+  return v < 10 ? '0' + v : 'A' + v - 10;
+}
+
+#if SERIAL_LINK_FRAMING
+// Two upper case hex digits, -1 when they are not
+static int16_t hexByte(const uint8_t* digits) {
+  int16_t v = 0;
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t c = digits[i];
+    if (c >= '0' && c <= '9') {
+      v = v << 4 | (c - '0');
+    } else if (c >= 'A' && c <= 'F') {
+      v = v << 4 | (c - 'A' + 10);
+    } else {
+      return -1;
+    }
+  }
+  return v;
+}
+#endif
+
+SerialLink::SerialLink(Stream& port, char separator, char end, char esc)
+  : highWater(0), merged(0), dropped(0), stalls(0), corrupt(0), lost(0), stream(port), fieldSeparator(separator),
+    frameEnd(end), escape(esc), tail(0), count(0), open(0), urgent(0), writeEscaped(false),
+    sendEscaped(false), sendMidFrame(false), nextMerges(false), nextUrgent(false), nextDrops(false), dropping(false),
+    openSent(false), openStalled(false), framed(false), txSeq(0), txCrc(0) {
+#if SERIAL_LINK_FRAMING
+  rxSeq = 0;
+  goodFrames = 0;
+  rxLength = 0;
+  rxRead = 0;
+  rxReady = false;
+  rxEscaped = false;
+#endif
+}
+
+void SerialLink::resetStats() {
+  highWater = count;
+  merged = 0;
+  dropped = 0;
+  stalls = 0;
+  corrupt = 0;
+  lost = 0;
+}
+
+void SerialLink::setFraming(bool on) {
+#if SERIAL_LINK_FRAMING
+  framed = on;
+#else
+  (void)on;
+#endif
+  txSeq = 0;
+  txCrc = 0;
+#if SERIAL_LINK_FRAMING
+  rxSeq = 0;
+  goodFrames = 0;
+  // A frame partly received is from the old rate
+  if (!rxReady) {
+    rxLength = 0;
+  }
+  rxEscaped = false;
+#endif
+}
+
+// ------------------------------------- Write -------------------------------------
+
+size_t SerialLink::write(uint8_t c) {
+  bool end = c == frameEnd && !writeEscaped;
+  writeEscaped = !writeEscaped && c == escape;
+  if (dropping) {
+    if (end) {
+      dropping = false;
+      nextDrops = false;
+    }
+    return 1;
+  }
+  if (count == kQueueSize) {
+    if (nextDrops && !openSent) {
+      count -= open;
+      open = 0;
+      dropped++;
+      nextMerges = false;
+      nextUrgent = false;
+      dropping = !end;
+      nextDrops = dropping;
+      return 1;
+    }
+    // The writer did not check room(): the oldest byte makes room
+    if (!openStalled) {
+      stalls++;
+      openStalled = true;
+    }
+    while (count == kQueueSize) {
+      sendOne();
+    }
+  }
+  queue[index(count)] = c;
+  count++;
+  open++;
+  if (count > highWater) {
+    highWater = count;
+  }
+  if (end) {
+    endFrame();
+  }
+  return 1;
+}
+
+void SerialLink::endFrame() {
+  if (nextMerges && !openSent) {
+    merge();
+  }
+  if (nextUrgent && !openSent) {
+    promote();
+  }
+  open = 0;
+  openSent = false;
+  openStalled = false;
+  nextMerges = false;
+  nextUrgent = false;
+  nextDrops = false;
+}
+
+// Remove the queued frame with the key of the frame just written: its text up to the
+// last unescaped field separator. Only whole frames not started on the wire are looked at.
+void SerialLink::merge() {
+  uint16_t start = count - open;
+  uint16_t key = 0;
+  bool escaped = false;
+  for (uint16_t i = 0; i < open; i++) {
+    uint8_t c = at(start + i);
+    if (c == fieldSeparator && !escaped) {
+      key = i;
+    }
+    escaped = !escaped && c == escape;
+  }
+  if (key == 0) {
+    return;
+  }
+  uint16_t frame = 0;
+  escaped = sendEscaped;
+  // Skip the rest of a frame that is partly sent
+  if (sendMidFrame) {
+    while (frame < start) {
+      uint8_t c = at(frame++);
+      bool end = c == frameEnd && !escaped;
+      escaped = !escaped && c == escape;
+      if (end) {
+        break;
+      }
+    }
+    escaped = false;
+  }
+  while (frame < start) {
+    uint16_t length = 0;
+    bool same = true;
+    while (frame + length < start) {
+      uint8_t c = at(frame + length);
+      if (length < key && c != at(start + length)) {
+        same = false;
+      }
+      if (length == key && c != fieldSeparator) {
+        same = false;
+      }
+      length++;
+      bool end = c == frameEnd && !escaped;
+      escaped = !escaped && c == escape;
+      if (end) {
+        break;
+      }
+    }
+    if (same && length > key) {
+      remove(frame, length);
+      merged++;
+      return;
+    }
+    frame += length;
+  }
+}
+
+// Move the frame just written to the end of the urgent lane. The rest of a normal frame
+// already on the wire stays in front of it.
+void SerialLink::promote() {
+  uint16_t start = count - open;
+  uint16_t to = urgent;
+  if (to == 0 && sendMidFrame) {
+    bool escaped = sendEscaped;
+    while (to < start) {
+      uint8_t c = at(to++);
+      bool end = c == frameEnd && !escaped;
+      escaped = !escaped && c == escape;
+      if (end) {
+        break;
+      }
+    }
+  }
+  // Rotate [to, count) so the frame comes first: three reversals, no extra buffer
+  if (to < start) {
+    reverse(to, start);
+    reverse(start, count);
+    reverse(to, count);
+  }
+  urgent = to + open;
+}
+
+// Close the gap of length bytes at from (relative to tail), the newer bytes move down
+void SerialLink::remove(uint16_t from, uint16_t length) {
+  for (uint16_t i = from; i + length < count; i++) {
+    queue[index(i)] = at(i + length);
+  }
+  count -= length;
+  if (from < urgent) {
+    urgent -= length;
+  }
+}
+
+void SerialLink::reverse(uint16_t from, uint16_t to) {
+  while (from + 1 < to) {
+    uint16_t a = index(from++);
+    uint16_t b = index(--to);
+    uint8_t c = queue[a];
+    queue[a] = queue[b];
+    queue[b] = c;
+  }
+}
+
+// ------------------------------------- Send --------------------------------------
+
+// Returns the bytes written to the port, the trailer included
+uint8_t SerialLink::sendOne() {
+  uint8_t c = queue[tail];
+  bool end = c == frameEnd && !sendEscaped;
+  uint8_t sent = 1;
+  if (framed) {
+    if (end) {
+      sendTrailer();
+      sent += kTrailer;
+    } else {
+      txCrc = crc8(txCrc, c);
+    }
+  }
+  stream.write(c);
+  tail = index(1);
+  count--;
+  if (urgent > 0) {
+    urgent--;
+  }
+  if (count < open) {
+    open = count;
+    openSent = true;
+  }
+  sendEscaped = !sendEscaped && c == escape;
+  sendMidFrame = !end;
+  return sent;
+}
+
+// Sequence number, then the CRC8 of the frame with it
+void SerialLink::sendTrailer() {
+  uint8_t digits[kTrailer];
+  digits[0] = hexDigit(txSeq >> 4);
+  digits[1] = hexDigit(txSeq & 0x0F);
+  txCrc = crc8(crc8(txCrc, digits[0]), digits[1]);
+  digits[2] = hexDigit(txCrc >> 4);
+  digits[3] = hexDigit(txCrc & 0x0F);
+  stream.write(digits, kTrailer);
+  txSeq++;
+  txCrc = 0;
+}
+
+uint16_t SerialLink::service() {
+  int space = stream.availableForWrite();
+  uint16_t moved = 0;
+  // The frame being written is left alone, it only goes out when it stalls. A frame end
+  // waits until its trailer fits too.
+  while (count > open) {
+    bool end = queue[tail] == frameEnd && !sendEscaped;
+    if (space < (framed && end ? 1 + kTrailer : 1)) {
+      break;
+    }
+    space -= sendOne();
+    moved++;
+  }
+  return moved;
+}
+
+void SerialLink::flush() {
+  while (count > 0) {
+    sendOne();
+  }
+  stream.flush();
+}
+
+// ------------------------------------ Receive ------------------------------------
+
+// Without SERIAL_LINK_FRAMING reads always pass through
+
+int SerialLink::available() {
+#if SERIAL_LINK_FRAMING
+  if (held()) {
+    return rxLength - rxRead;
+  }
+  if (framed) {
+    return 0;
+  }
+#endif
+  return stream.available();
+}
+
+int SerialLink::peek() {
+#if SERIAL_LINK_FRAMING
+  if (held()) {
+    return rx[rxRead];
+  }
+  if (framed) {
+    return -1;
+  }
+#endif
+  return stream.peek();
+}
+
+int SerialLink::read() {
+#if SERIAL_LINK_FRAMING
+  if (held()) {
+    uint8_t c = rx[rxRead++];
+    if (rxRead == rxLength) {
+      rxReady = false;
+      rxLength = 0;
+      rxRead = 0;
+    }
+    return c;
+  }
+  if (framed) {
+    return -1;
+  }
+#endif
+  return stream.read();
+}
+
+#if SERIAL_LINK_FRAMING
+
+// A good frame is waiting to be read, received now if needed. Also right after framing
+// went off, for the last frame received with it.
+bool SerialLink::held() {
+  if (!rxReady && framed) {
+    receive();
+  }
+  return rxReady;
+}
+
+// Take bytes from the port until a frame ends. What follows it stays in the port.
+void SerialLink::receive() {
+  while (!rxReady && stream.available() > 0) {
+    uint8_t c = stream.read();
+    bool end = c == frameEnd && !rxEscaped;
+    rxEscaped = !rxEscaped && c == escape;
+    if (end) {
+      accept();
+    } else if (rxLength < sizeof(rx)) {
+      rx[rxLength++] = c;
+    } else {
+      rxLength = sizeof(rx) + 1;
+    }
+  }
+}
+
+// A frame ended: pass it on when its trailer is right, count it when not
+void SerialLink::accept() {
+  uint8_t length = rxLength;
+  rxLength = 0;
+  if (length == 0) {
+    return;
+  }
+  if (length <= kTrailer || length > sizeof(rx)) {
+    corrupt++;
+    return;
+  }
+  uint8_t payload = length - kTrailer;
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < payload + 2; i++) {
+    crc = crc8(crc, rx[i]);
+  }
+  int16_t seq = hexByte(rx + payload);
+  if (seq < 0 || hexByte(rx + payload + 2) != crc) {
+    corrupt++;
+    return;
+  }
+  // The frames in between were rejected above or never arrived
+  lost += (uint8_t)(seq - rxSeq);
+  rxSeq = seq + 1;
+  goodFrames++;
+  rx[payload] = frameEnd;
+  rxLength = payload + 1;
+  rxReady = true;
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Wear-levelled EEPROM settings store.
+*
+*/
+
+#include <EEPROM.h>
+#include "SettingsStore.h"
+
+SettingsStore::SettingsStore(uint16_t address, uint8_t slotCount)
+  : base(address), slots(slotCount), newest(slotCount), pendingSlot(0), written(sizeof(Record)) {
+  memset(&last, 0, sizeof(last));
+  memset(&pending, 0, sizeof(pending));
+}
+
+// ------------------------------------- Load --------------------------------------
+
+bool SettingsStore::load(Settings& settings) {
+  // Saves go round the ring in order, so the newest record is the valid one
+  // whose next slot does not hold its successor.
+  newest = slots;
+  for (uint8_t slot = 0; slot < slots; slot++) {
+    Record record;
+    if (!readSlot(slot, record)) {
+      continue;
+    }
+    Record next;
+    uint8_t nextSlot = (slot + 1) % slots;
+    if (readSlot(nextSlot, next) && next.sequence == (uint8_t)(record.sequence + 1)) {
+      continue;
+    }
+    newest = slot;
+    last = record;
+    break;
+  }
+  if (newest == slots) {
+    return false;
+  }
+  settings = last.settings;
+  return true;
+}
+
+bool SettingsStore::readSlot(uint8_t slot, Record& record) {
+  uint8_t* bytes = (uint8_t*)&record;
+  uint16_t address = base + slot * sizeof(Record);
+  for (uint8_t i = 0; i < sizeof(Record); i++) {
+    bytes[i] = EEPROM.read(address + i);
+  }
+  return record.version == kVersion && record.crc == crc8(bytes, sizeof(Record) - 1);
+}
+
+// ------------------------------------- Save --------------------------------------
+
+void SettingsStore::save(const Settings& settings) {
+  if (newest != slots && memcmp(&settings, &last.settings, sizeof(Settings)) == 0) {
+    // Back to what is stored: drop the save in progress, its slot has no valid CRC yet
+    written = sizeof(Record);
+    return;
+  }
+  pending.version = kVersion;
+  pending.sequence = newest == slots ? 0 : last.sequence + 1;
+  pending.settings = settings;
+  pending.crc = crc8((const uint8_t*)&pending, sizeof(Record) - 1);
+  pendingSlot = newest == slots ? 0 : (newest + 1) % slots;
+  written = 0;
+}
+
+bool SettingsStore::service() {
+  if (written == sizeof(Record)) {
+    return false;
+  }
+  if (!eeprom_is_ready()) {
+    return true;
+  }
+  // In order, CRC last: a reset halfway leaves a slot that fails the check
+  uint16_t address = base + pendingSlot * sizeof(Record);
+  EEPROM.update(address + written, ((const uint8_t*)&pending)[written]);
+  written++;
+  if (written < sizeof(Record)) {
+    return true;
+  }
+  newest = pendingSlot;
+  last = pending;
+  return false;
+}
+
+// Dallas/Maxim CRC-8
+uint8_t SettingsStore::crc8(const uint8_t* data, uint8_t length) {
+  uint8_t crc = 0;
+  while (length--) {
+    uint8_t b = *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      b >>= 1;
+    }
+  }
+  return crc;
+}
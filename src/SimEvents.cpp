@@ -0,0 +1,26 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : SimConnect event names in PROGMEM.
+*
+*/
+
+#include "SimEvents.h"
+
+#define SIM_EVENT_STRING(name) static const char evName_##name[] PROGMEM = "SIMCONNECT:" #name;
+#define SIM_EVENT_POINTER(name) evName_##name,
+
+SIM_EVENT_LIST(SIM_EVENT_STRING)
+
+static const char* const simEventNames[evCount] PROGMEM = {
+  nullptr,
+  SIM_EVENT_LIST(SIM_EVENT_POINTER)
+};
+
+const __FlashStringHelper* simEventName(uint8_t event) {
+  if (event == evNone || event >= evCount) {
+    return nullptr;
+  }
+  return (const __FlashStringHelper*)pgm_read_ptr(&simEventNames[event]);
+}
@@ -0,0 +1,60 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : Hot path instrumentation.
+*
+*/
+
+#include "Stats.h"
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  memset(count, 0, sizeof(count));
+  total = 0;
+  longest = 0;
+}
+
+void LatencyHistogram::add(unsigned long us) {
+  uint8_t bucket = 0;
+  while (us >> bucket && bucket < kBuckets - 1) {
+    bucket++;
+  }
+  // Full: halve every bucket, the shape of the distribution is kept
+  if (count[bucket] == 0xFF) {
+    for (uint8_t i = 0; i < kBuckets; i++) {
+      count[i] >>= 1;
+    }
+  }
+  count[bucket]++;
+  if (total != 0xFFFF) {
+    total++;
+  }
+  if (us > longest) {
+    longest = us;
+  }
+}
+
+unsigned long LatencyHistogram::percentile(uint8_t p) const {
+  uint16_t held = 0;
+  for (uint8_t bucket = 0; bucket < kBuckets; bucket++) {
+    held += count[bucket];
+  }
+  if (held == 0) {
+    return 0;
+  }
+  // Samples at or below the percentile, rounded up
+  unsigned long wanted = ((unsigned long)held * p + 99) / 100;
+  unsigned long seen = 0;
+  for (uint8_t bucket = 0; bucket < kBuckets; bucket++) {
+    seen += count[bucket];
+    if (seen >= wanted) {
+      unsigned long upper = (1UL << bucket) - 1;
+      return upper < longest ? upper : longest;
+    }
+  }
+  return longest;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************
+* Project           : OneKnobRadioFS20
+* License           : MIT
+*
+* Description       : SPAD.neXt keyword classifier.
+*
+*/
+
+#include "Tokens.h"
+
+static const char tokEND[] PROGMEM = "END";
+static const char tokINIT[] PROGMEM = "INIT";
+static const char tokBAUD[] PROGMEM = "BAUD";
+static const char tokPING[] PROGMEM = "PING";
+static const char tokMSFS[] PROGMEM = "MSFS";
+static const char tokALIAS[] PROGMEM = "ALIAS";
+static const char tokSTART[] PROGMEM = "START";
+static const char tokSTATS[] PROGMEM = "STATS";
+static const char tokCONFIG[] PROGMEM = "CONFIG";
+static const char tokBINARY[] PROGMEM = "BINARY";
+static const char tokPROVIDER[] PROGMEM = "PROVIDER";
+
+// The candidate must match completely, anything else of the same shape is unknown
+static Token confirm(const char* s, const char* keyword, Token token) {
+  return strcmp_P(s, keyword) == 0 ? token : tkUnknown;
+}
+
+Token classifyToken(const char* s) {
+  // CmdMessenger gives NULL past the last argument
+  if (s == NULL) {
+    return tkUnknown;
+  }
+  switch (strlen(s)) {
+    case 3:
+      return confirm(s, tokEND, tkEND);
+    case 4:
+      switch (s[0]) {
+        case 'I': return confirm(s, tokINIT, tkINIT);
+        case 'B': return confirm(s, tokBAUD, tkBAUD);
+        case 'P': return confirm(s, tokPING, tkPING);
+        case 'M': return confirm(s, tokMSFS, tkMSFS);
+      }
+      return tkUnknown;
+    case 5:
+      switch (s[0]) {
+        case 'A': return confirm(s, tokALIAS, tkALIAS);
+        // STAR-T / STAT-S
+        case 'S': return s[3] == 'R' ? confirm(s, tokSTART, tkSTART) : confirm(s, tokSTATS, tkSTATS);
+      }
+      return tkUnknown;
+    case 6:
+      return s[0] == 'C' ? confirm(s, tokCONFIG, tkCONFIG) : confirm(s, tokBINARY, tkBINARY);
+    case 8:
+      return confirm(s, tokPROVIDER, tkPROVIDER);
+  }
+  return tkUnknown;
+}
@@ -19,29 +19,27 @@
 *
 */
 
-#include <LiquidCrystal.h>
 #include <CmdMessenger.h>  
 #include <EncoderButton.h>
 #include <EEPROM.h>
+#include "AsyncLcd.h"
+#include "FixedPoint.h"
+#include "SimEvents.h"
+#include "SettingsStore.h"
+#include "Stats.h"
+#include "QuadDecoder.h"
+#include "Tokens.h"
+#include "LcdFrameBuffer.h"
+#include "Scheduler.h"
+#include "SerialLink.h"
+#include "RamMonitor.h"
 
 // ------------------ V A R I A B L E S  D E C L A R A T I O N S ------------------------------
 
 bool isReady = false;
-// Mode selector: (false) = Khz; (true) = Mhz; --- Default: Khz 
-bool freqSelMode = true; 
-// System selector:  (1)=COM1; (2)=NAV1; (3)=COM2; (4)=NAV2; (5)=ADF; (6)=XPNDR; --- Default: COM1 
-int sysSelect = 1;
-// ADF mode selector: (false)=Frequency; (true)=Heading; --- Default: Frequency
-bool modeADF = false;
-//Frequency fraction selector: (0)=0.1Khz;(1)=1Khz;(2)=10Khz;(3)=100Khz; --- Default: 1Khz
-int freqADF = 1;
-// IDENT decimal selector: (1)=Unit; (2)=Decimal; (3)=Hundred; (4)=Thousand
-int decIDENT = 1;
+// Selection state of each knob (system, unit, config mode) is in its Panel, see P A N E L S
 //Display mode selector
 bool modeLCD = false;       // (false)=COM/NAV; (true)=NAV/NAV;
-// Configuration mode selector
-bool configMode = false;
-int configState = 1;        // (1)=Display mode; (2)=Lighting; (3)=Contrast
 // LCD Display Lighting; Pin - Value 
 int luzPin = 5;
 byte iluminacionDef = 150;
@@ -50,25 +48,117 @@ byte iluminacion;
 int contrastePin = 6;
 byte contrasteDef = 105;
 byte contraste;
-bool pwmset = false;
-// Data Containers
-float newADFActiveFreq = 123;
+bool pwmset = false;        // true once the settings were loaded or changed
+// Settings are saved when config mode exits, or after settingsIdleMs without changes
+const unsigned long settingsIdleMs = 10000;
+bool settingsDirty = false;
+unsigned long settingsChangedMs = 0;
+// Encoder acceleration and batching
+const unsigned long accelRate = 12;       // Detents per second that switch to the coarse unit
+const int accelConfigStep = 5;            // Brightness / contrast step while turning fast
+// Absolute SET mode: the knob moves a local target and one SET event is sent when it settles.
+// A channel is only edited this way once its value has been received, else INC/DEC is used.
+bool modeSET = true;
+const unsigned long setSettleMs = 150;    // Quiet time after the last detent before SET is sent
+bool setPending = false;
+int setChannel = 0;                       // Data channel of the target (kCOM1StandbyFreq, kXpndr, ...)
+long setTarget = 0;                       // Target value, see channelValue()
+unsigned long lastSetStepMs = 0;
+// Prediction: each detent is applied at once to a local copy of the edited channel and shown,
+// until the sim sends the same value or predictHoldMs pass without it.
+const unsigned long predictHoldMs = 1000; // After the last detent or SET sent
+bool predictActive = false;
+int predictChannel = 0;
+long predictValue = 0;
+unsigned long predictMs = 0;
+unsigned long predictHits = 0;            // Confirmed by the sim
+unsigned long predictMisses = 0;          // Expired with the sim showing something else
+bool com833 = false;                      // 8.33 Khz COM spacing, set when a COM value needs it
+unsigned int channelsSeen = 0;            // One bit per data channel received, see channelBit()
+// Inbound change detection: only real changes of shown values cause a redraw
+uint8_t channelGeneration[12];            // +1 on every change, by [data channel - kADFActiveFreq]
+unsigned long updatesChanged = 0;
+unsigned long updatesUnchanged = 0;       // Same value re-sent, dropped
+unsigned long updatesOffscreen = 0;       // Changed, but not on the current screen
+// Subscriptions follow the screen: what it shows plus the next screen, see subscriptionScheduler()
+bool subscriptionsOn = false;
+unsigned int subscribedChannels = 0;      // channelBit() of each subscribed data channel
+// Short event aliases, only when the host asked for them with "0,CONFIG,ALIAS;"
+bool aliasesOn = false;
+uint8_t aliasNext = evNone;               // Next event to register, evNone when none, see aliasScheduler()
+// The CONFIG reply follows the initial subscriptions and alias lines, see configScheduler()
+bool configReplyPending = false;
+bool configReplyBinary = false;
+// Render scheduler: callbacks only mark a screen dirty, loop() redraws it at most once per frame
+const unsigned long frameInterval = 33;   // ms between redraws (~30 Hz)
+const uint8_t lcdSliceBytes = 4;          // LCD bytes sent per loop() pass and display
+unsigned long renderCount = 0;            // Frames drawn
+unsigned long renderSkipped = 0;          // Redraw requests merged into a pending frame
+// loop() runs the tasks of T A S K S. The knobs are read at least every knobBoundUs (plus
+// one task run). The serial task parses at most serialSliceBytes per run, serialStepBytes at
+// a time, and stops once the callbacks took it past serialBudgetUs. A callback is not cut
+// short, so one slow callback can still take a run past it. The draw task redraws one
+// display per run.
+const uint16_t knobBoundUs = 1000;
+const uint8_t serialSliceBytes = 32;
+const uint8_t serialStepBytes = 8;
+const uint16_t serialBudgetUs = 2000;
+uint8_t drawNext = 0;                     // Panel the draw task looks at next
+// Serial rate: SPAD.neXt opens the port at baseBaud. A host that offers more at INIT gets the
+// fastest of fastBauds it takes, then every frame carries a sequence number and a CRC8, see
+// SerialLink. Back to baseBaud when no good frame arrives for baudConfirmMs after the switch,
+// or for baudSilenceMs later on (the host went away), see baudScheduler().
+const unsigned long baseBaud = 115200;
+const unsigned long fastBauds[3] PROGMEM = { 1000000, 500000, 250000 };   // Exact at 16 Mhz
+const unsigned long baudConfirmMs = 500;
+const unsigned long baudSilenceMs = 3000;
+unsigned long baudNow = baseBaud;
+unsigned long baudNext = 0;               // Rate to switch to once the queue is out, 0 when none
+bool baudConfirmed = false;               // A good frame came at baudNow
+unsigned long baudSinceMs = 0;            // Switch, or last good frame
+uint16_t baudFramesSeen = 0;              // serialLink.framesIn() then
+unsigned long baudFallbacks = 0;
+// Handshake replies wait for room in the outbound queue, see handshakeScheduler()
+bool initReplyPending = false;
+unsigned long baudReplyRate = 0;          // Rate to answer "0,BAUD,<rate>;" with, 0 when none
+bool pongPending = false;
+long pongValue = 0;
+// Instrumentation, reported by the STATS request. Debug builds also send it to the
+// SPAD.neXt log every statsInterval ms.
+#define DEBUG_STATS 0
+const unsigned long statsInterval = 10000;
+unsigned long lastStatsMs = 0;            // Start of the current stats window
+const uint8_t statsIdle = 0xFF;
+uint8_t statsNext = statsIdle;            // Next section of the STATS reply, see statsScheduler()
+byte statsCmdId = 0;                      // kRequest, or kDebug for the log copy
+unsigned long lastLoopUs = 0;
+LatencyHistogram loopStats;               // Period of loop()
+LatencyHistogram renderStats;             // printLCD()
+LatencyHistogram callbackStats;           // feedinSerialData() passes that received bytes, callbacks included
+LatencyHistogram inputStats;              // Encoder detent to loop() handling it
+// RAM: free at boot and the least since, see RamMonitor.h. Below ramReserve at boot the splash
+// screen says so: the stack of the deepest callback chain plus an interrupt may reach the globals.
+const uint16_t ramReserve = 256;
+uint16_t ramAtBoot = kRamUnknown;
+// Data Containers. Fixed point: COM/NAV in Khz (118.025 = 118025), ADF in 0.1 Khz (350.5 = 3505)
+long newADFActiveFreq = 1230;
 int newADFHDG;
-float newCOM1StandbyFreq = 0;
-float newCOM1ActiveFreq = 0;
-float newCOM2StandbyFreq = 0;
-float newCOM2ActiveFreq = 0;
-float newNAV1StandbyFreq = 0;
-float newNAV1ActiveFreq = 0;
-float newNAV2StandbyFreq = 00;
-float newNAV2ActiveFreq = 0;
+long newCOM1StandbyFreq = 0;
+long newCOM1ActiveFreq = 0;
+long newCOM2StandbyFreq = 0;
+long newCOM2ActiveFreq = 0;
+long newNAV1StandbyFreq = 0;
+long newNAV1ActiveFreq = 0;
+long newNAV2StandbyFreq = 0;
+long newNAV2ActiveFreq = 0;
 int newXpndr = 7000;
 bool newIDENT;
 
 // ---------------------- C U S T O M   D I S P L A Y   C H A R A C T E R S --------------------
+// In flash, loaded into the display CGRAM by createChar_P()
 
 // C 
-byte customCharC[8] = {
+const byte customCharC[8] PROGMEM = {
 	0b00000,
 	0b00000,
 	0b01110,
@@ -80,7 +170,7 @@ byte customCharC[8] = {
 };
 
 // 1
-byte customChar1[8] = {
+const byte customChar1[8] PROGMEM = {
 	0b00000,
 	0b00000,
 	0b00100,
@@ -92,7 +182,7 @@ byte customChar1[8] = {
 };
 
 // N
-byte customCharN[8] = {
+const byte customCharN[8] PROGMEM = {
 	0b00000,
 	0b00000,
 	0b01001,
@@ -104,7 +194,7 @@ byte customCharN[8] = {
 };
 
 // 2
-byte customChar2[8] = {
+const byte customChar2[8] PROGMEM = {
 	0b00000,
 	0b00000,
 	0b00110,
@@ -116,20 +206,135 @@ byte customChar2[8] = {
 };
 
 
-// ------------------------ L I B R A R I E S  I N I T I A L I T A T I O N ---------------
+// ------------------------------------- P A N E L S ----------------------------------------
+
+// One knob with its push button and one 2x16 display. Each panel has its own system selection,
+// cursor and screen; the radio values, the SET target and the subscriptions are shared, so all
+// panels show the same sim. Encoder: QuadDecoder interface. Display: AsyncLcd interface.
+template <class Encoder, class Display>
+class Panel {
+public:
+  Panel(uint8_t index, Encoder& encoder, EncoderButton& pushButton, Display& display);
+  void begin();
+
+  // Button handlers, reached through the router by the button's user id. A gesture waits
+  // until the steps turned before it are queued, see press().
+  void onClicked() { press(gestureClick); }
+  void onLongClick() { press(gestureLongClick); }
+  void onDoubleClick() { press(gestureDoubleClick); }
+  void onTripleClick() { press(gestureTripleClick); }
+
+  // loop() work of this panel alone, it does not grow with the number of panels
+  void update();                  // Encoder steps and their batch, button
+  void renderScheduler();
+  void service();                 // Send a few queued bytes to the display
+
+  void requestRender();
+  void blank();                   // Clear the display, connection up / down
+  unsigned int screen() const;    // Data channels on screen, none in config mode
+  unsigned int wanted() const;    // Data channels to keep subscribed
+  bool inConfig() const { return configMode; }
+  uint16_t overflows() { return knob.overflows(); }
+
+private:
+  enum Gesture : uint8_t {
+    gestureNone,
+    gestureClick,
+    gestureLongClick,
+    gestureDoubleClick,
+    gestureTripleClick
+  };
+
+  void press(uint8_t gesture);
+  bool runGesture();
+  void clicked();
+  void longClicked();
+  void doubleClicked();
+  void tripleClicked();
+  void readEncoder();
+  void onEncoderStep(const EncoderStep& step);
+  void sendEncoderBatch();
+  bool sendHeldSteps(bool all);
+  void sendRotationEvent(bool increase, int unit);
+  int selectedUnit(bool coarse) const;
+  int editChannel() const;
+  uint8_t shownGeneration() const;
+  void render();
+
+  Encoder& knob;
+  EncoderButton& button;
+  Display& lcd;
+  LcdFrameBuffer fb;              // Shadow framebuffer, only changes reach the display
+  uint8_t id;                     // Index in panels[]
+  // System selector:  (1)=COM1; (2)=NAV1; (3)=COM2; (4)=NAV2; (5)=ADF; (6)=XPNDR; --- Default: COM1
+  uint8_t sysSelect;
+  // Frequency fraction selector: (0)=0.1Khz;(1)=1Khz;(2)=10Khz;(3)=100Khz; --- Default: 1Khz
+  uint8_t freqADF;
+  // IDENT decimal selector: (1)=Unit; (2)=Decimal; (3)=Hundred; (4)=Thousand
+  uint8_t decIDENT;
+  uint8_t configState;            // (1)=Display mode; (2)=Lighting; (3)=Contrast
+  uint8_t renderedGeneration;     // shownGeneration() at the last redraw request
+  bool freqSelMode;               // (false) = Khz; (true) = Mhz; --- Default: Mhz
+  bool modeADF;                   // (false)=Frequency; (true)=Heading
+  bool configMode;
+  bool renderPending;
+  bool lcdSynced;                 // false while a frame is still being queued to the display
+  int8_t pendingFine;             // Net steps in the selected unit, not sent yet
+  int8_t pendingCoarse;           // Net steps in the next coarser unit, not sent yet
+  int16_t heldFine;               // Net INC/DEC events waiting for the link, see sendHeldSteps()
+  int16_t heldCoarse;
+  uint8_t deferredGesture;        // Gesture waiting for the held steps to be queued
+  unsigned long lastStepUs;       // Time of the previous encoder detent
+  unsigned long lastRenderMs;
+};
 
-// ----- LiquidCristal --------
-// Pin configuration: RS, E, D4, D5, D6, D7
-const int rs = A5, en = A4, d4 = A3, d5 = A2, d6 = A1, d7 = A0;
-// LiquidCrystal Initialization
-LiquidCrystal lcd(rs, en, d4, d5, d6, d7);
+template <class Encoder, class Display>
+Panel<Encoder, Display>::Panel(uint8_t index, Encoder& encoder, EncoderButton& pushButton, Display& display)
+  : knob(encoder), button(pushButton), lcd(display), id(index), sysSelect(1), freqADF(1), decIDENT(1),
+    configState(1), renderedGeneration(0), freqSelMode(true), modeADF(false), configMode(false),
+    renderPending(false), lcdSynced(true), pendingFine(0), pendingCoarse(0), heldFine(0), heldCoarse(0),
+    deferredGesture(gestureNone), lastStepUs(0), lastRenderMs(0) {
+}
 
-// ----- CmdMessenger --------
-CmdMessenger messenger(Serial);
+typedef Panel<QuadDecoder, AsyncLcd> RadioPanel;
 
-// ----- EncoderButton --------
-// EncoderButton Initialization. PinA, PinB, Button
-EncoderButton eb1(2, 3, 4);   
+
+// ------------------------ L I B R A R I E S  I N I T I A L I T A T I O N ---------------
+
+// ----- CmdMessenger --------
+// The link counts the bytes going through the serial port. All panels share it.
+// Outbound frames wait in serialLink and go out as the UART has room, see txTask().
+SerialLink serialLink(Serial);
+CountingStream link(serialLink);
+CmdMessenger messenger(link);
+
+// ----- Panels --------
+// Per panel: quadrature decoder on two interrupt pins (PinA, PinB), EncoderButton switch only
+// (Button), and a non-blocking HD44780 driver (RS, E, D4, D5, D6, D7).
+// The backlight and contrast pins are shared, see luzPin / contrastePin.
+QuadDecoder knob1(2, 3);
+EncoderButton eb1(4);   
+AsyncLcd lcd1(A5, A4, A3, A2, A1, A0);
+RadioPanel panel1(0, knob1, eb1, lcd1);
+#if defined(__AVR_ATmega2560__)
+// Mega: two more knobs on the remaining interrupt pins
+QuadDecoder knob2(18, 19);
+EncoderButton eb2(22);
+AsyncLcd lcd2(23, 25, 27, 29, 31, 33);
+RadioPanel panel2(1, knob2, eb2, lcd2);
+QuadDecoder knob3(20, 21);
+EncoderButton eb3(24);
+AsyncLcd lcd3(35, 37, 39, 41, 43, 45);
+RadioPanel panel3(2, knob3, eb3, lcd3);
+RadioPanel* const panels[] = { &panel1, &panel2, &panel3 };
+#else
+RadioPanel* const panels[] = { &panel1 };
+#endif
+const uint8_t panelCount = sizeof(panels) / sizeof(panels[0]);
+
+// ----- Settings --------
+// 32 records of 6 bytes from EEPROM address 0, each cell is written once every 32 saves
+SettingsStore settingsStore(0, 32);
 
 
 // -------------------------------- C O M M A N D S ------------------------------------
@@ -141,6 +346,7 @@ enum
   kEvent = 2,               // Events from SPAD.neXt
   kDebug = 3,               // Debug strings to SPAD.neXt Logfile
   kSimCommand = 4,          // Send Event to Simulation
+  kAliasCommand = 9,        // Send Event to Simulation by alias id, see aliasScheduler()
   kADFActiveFreq = 10,      // Receive ADF Active Frequency
   kCOM1ActiveFreq = 11,     // Receive COM1 Active Frequency
   kCOM1StandbyFreq = 12,    // Receive COM1 Standby Frequency
@@ -152,131 +358,258 @@ enum
   kNAV2StandbyFreq = 18,    // Receive NAV2 Standby Frequency
   kADFHDG = 19,             // Receive ADF Heading
   kXpndr = 20,              // Receive Xpndr Code
-  kIDENT = 21               // Receive IDENT
+  kIDENT = 21,              // Receive IDENT
+  kValues = 22              // Receive several values in binary, see onValues()
+};
+
+// Bit of a data channel in channelsSeen
+constexpr unsigned int channelBit(int channel) {
+  return 1U << (channel - kADFActiveFreq);
+}
+
+// ---------------------------- E V E N T   T A B L E S -------------------------------
+// Adding a radio is a new row in each table. Event names are in SimEvents.h.
+
+// Rotation events by [system][sub-mode][direction]. Direction: (0)=Decrease; (1)=Increase
+// Sub-mode: COM/NAV (0)=Khz (1)=Mhz; ADF (0)=0.1Khz (1)=1Khz (2)=10Khz (3)=100Khz (4)=Card;
+//           XPNDR (0)=First .. (3)=Fourth digit
+const uint8_t rotationEvents[6][5][2] PROGMEM = {
+  { // COM1
+    { evCOM_RADIO_FRACT_DEC_CARRY, evCOM_RADIO_FRACT_INC_CARRY },
+    { evCOM_RADIO_WHOLE_DEC, evCOM_RADIO_WHOLE_INC },
+  },
+  { // NAV1
+    { evNAV1_RADIO_FRACT_DEC, evNAV1_RADIO_FRACT_INC },
+    { evNAV1_RADIO_WHOLE_DEC, evNAV1_RADIO_WHOLE_INC },
+  },
+  { // COM2
+    { evCOM2_RADIO_FRACT_DEC_CARRY, evCOM2_RADIO_FRACT_INC_CARRY },
+    { evCOM2_RADIO_WHOLE_DEC, evCOM2_RADIO_WHOLE_INC },
+  },
+  { // NAV2
+    { evNAV2_RADIO_FRACT_DEC, evNAV2_RADIO_FRACT_INC },
+    { evNAV2_RADIO_WHOLE_DEC, evNAV2_RADIO_WHOLE_INC },
+  },
+  { // ADF
+    { evADF_FRACT_DEC_CARRY, evADF_FRACT_INC_CARRY },
+    { evADF_1_DEC, evADF_1_INC },
+    { evADF_10_DEC, evADF_10_INC },
+    { evADF_100_DEC, evADF_100_INC },
+    { evADF_CARD_DEC, evADF_CARD_INC },
+  },
+  { // XPNDR
+    { evXPNDR_1_DEC, evXPNDR_1_INC },
+    { evXPNDR_10_DEC, evXPNDR_10_INC },
+    { evXPNDR_100_DEC, evXPNDR_100_INC },
+    { evXPNDR_1000_DEC, evXPNDR_1000_INC },
+  },
+};
+
+// Highest sub-mode a fast turn is promoted to, by [system]
+const uint8_t coarseLimit[6] PROGMEM = { 1, 1, 1, 1, 3, 3 };
+
+// Long click event by [system]. ADF has none, it toggles frequency / heading.
+const uint8_t longClickEvents[6] PROGMEM = {
+  evCOM1_RADIO_SWAP, evNAV1_RADIO_SWAP, evCOM2_RADIO_SWAP, evNAV2_RADIO_SWAP, evNone, evXPNDR_IDENT_ON
 };
 
+// Absolute SET event by [data channel - kADFActiveFreq]
+const uint8_t setEvents[12] PROGMEM = {
+  evADF_COMPLETE_SET,         // kADFActiveFreq
+  evNone,                     // kCOM1ActiveFreq
+  evCOM_STBY_RADIO_SET_HZ,    // kCOM1StandbyFreq
+  evNone,                     // kNAV1ActiveFreq
+  evNAV1_STBY_SET_HZ,         // kNAV1StandbyFreq
+  evNone,                     // kCOM2ActiveFreq
+  evCOM2_STBY_RADIO_SET_HZ,   // kCOM2StandbyFreq
+  evNone,                     // kNAV2ActiveFreq
+  evNAV2_STBY_SET_HZ,         // kNAV2StandbyFreq
+  evADF_CARD_SET,             // kADFHDG
+  evXPNDR_SET,                // kXpndr
+  evNone                      // kIDENT
+};
+
+// ------------------------- S U B S C R I P T I O N   T A B L E S ---------------------------
+
+// SimConnect variable by [data channel - kADFActiveFreq]
+const char pathADFActiveFreq[] PROGMEM = "SIMCONNECT:ADF ACTIVE FREQUENCY:1";
+const char pathCOM1ActiveFreq[] PROGMEM = "SIMCONNECT:COM ACTIVE FREQUENCY:1";
+const char pathCOM1StandbyFreq[] PROGMEM = "SIMCONNECT:COM STANDBY FREQUENCY:1";
+const char pathNAV1ActiveFreq[] PROGMEM = "SIMCONNECT:NAV ACTIVE FREQUENCY:1";
+const char pathNAV1StandbyFreq[] PROGMEM = "SIMCONNECT:NAV STANDBY FREQUENCY:1";
+const char pathCOM2ActiveFreq[] PROGMEM = "SIMCONNECT:COM ACTIVE FREQUENCY:2";
+const char pathCOM2StandbyFreq[] PROGMEM = "SIMCONNECT:COM STANDBY FREQUENCY:2";
+const char pathNAV2ActiveFreq[] PROGMEM = "SIMCONNECT:NAV ACTIVE FREQUENCY:2";
+const char pathNAV2StandbyFreq[] PROGMEM = "SIMCONNECT:NAV STANDBY FREQUENCY:2";
+const char pathADFHDG[] PROGMEM = "SIMCONNECT:ADF CARD";
+const char pathXpndr[] PROGMEM = "SIMCONNECT:TRANSPONDER CODE:1";
+const char pathIDENT[] PROGMEM = "SIMCONNECT:TRANSPONDER IDENT";
+
+const char* const dataPaths[12] PROGMEM = {
+  pathADFActiveFreq, pathCOM1ActiveFreq, pathCOM1StandbyFreq, pathNAV1ActiveFreq,
+  pathNAV1StandbyFreq, pathCOM2ActiveFreq, pathCOM2StandbyFreq, pathNAV2ActiveFreq,
+  pathNAV2StandbyFreq, pathADFHDG, pathXpndr, pathIDENT
+};
+
+// Data channels each screen shows, by [modeLCD][system]
+const unsigned int screenCOM1NAV1 = channelBit(kCOM1ActiveFreq) | channelBit(kCOM1StandbyFreq) |
+                                    channelBit(kNAV1ActiveFreq) | channelBit(kNAV1StandbyFreq);
+const unsigned int screenCOM2NAV2 = channelBit(kCOM2ActiveFreq) | channelBit(kCOM2StandbyFreq) |
+                                    channelBit(kNAV2ActiveFreq) | channelBit(kNAV2StandbyFreq);
+const unsigned int screenCOM1COM2 = channelBit(kCOM1ActiveFreq) | channelBit(kCOM1StandbyFreq) |
+                                    channelBit(kCOM2ActiveFreq) | channelBit(kCOM2StandbyFreq);
+const unsigned int screenNAV1NAV2 = channelBit(kNAV1ActiveFreq) | channelBit(kNAV1StandbyFreq) |
+                                    channelBit(kNAV2ActiveFreq) | channelBit(kNAV2StandbyFreq);
+const unsigned int screenADF = channelBit(kADFActiveFreq) | channelBit(kADFHDG);
+const unsigned int screenXPNDR = channelBit(kXpndr) | channelBit(kIDENT);
+
+const uint16_t screenChannels[2][6] PROGMEM = {
+  { screenCOM1NAV1, screenCOM1NAV1, screenCOM2NAV2, screenCOM2NAV2, screenADF, screenXPNDR },   // COM/NAV
+  { screenCOM1COM2, screenNAV1NAV2, screenCOM1COM2, screenNAV1NAV2, screenADF, screenXPNDR },   // COM/COM
+};
+
+// ------------------------------- P R O T O T Y P E S --------------------------------
+
+bool flushSetEvent();
+void handshakeScheduler();
+void onEncoderStep(const EncoderStep& step);
+void sendSimEvent(uint8_t event);
+void predictSteps(int channel, int coarse, int coarseUnit, int fine, int fineUnit);
+void reconcilePrediction(int channel, long received);
+long shownValue(int channel, long value);
+unsigned int screenOf(int system);
+void subscriptionScheduler();
+unsigned int wantedChannels();
+bool configuring();
+void renderPanels(unsigned int channels);
+void applyConfig();
+void saveSettings();
+long channelValue(int channel);
+long stepChannel(int channel, long value, int steps, int unit);
+void onButtonClicked(EncoderButton& eb);
+void onButtonLongClick(EncoderButton& eb);
+void onButtonDoubleClick(EncoderButton& eb);
+void onButtonTripleClick(EncoderButton& eb);
+bool sendTaskStats(uint8_t i);
+void statsScheduler();
+void baudScheduler();
+
 // -------------------------------- F U N C T I O N S ----------------------------------
 
 // ------------------ LCD Print ----------------
-void printLCD(){
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::render(){
 
-  lcd.cursor();
-  lcd.clear();
+  fb.clear();
   if (configMode == 0) {       
     if (modeLCD == 0) {          // COM/NAV
       // --- COM1 o NAV1 ---
       if (sysSelect == 1 || sysSelect == 2) {
-        lcd.setCursor(0,0);
-        lcd.print(newCOM1ActiveFreq,3);
-        lcd.setCursor(7,0);
-        lcd.write(byte(1));
-        lcd.setCursor(8,0);
-        lcd.write(byte(2));
-        lcd.setCursor(9,0);
-        lcd.print(newCOM1StandbyFreq,3);    
-        lcd.setCursor(0,1);
-        lcd.print(newNAV1ActiveFreq,3);
-        lcd.setCursor(7,1);
-        lcd.write(byte(3));
-        lcd.setCursor(8,1);
-        lcd.write(byte(2));
-        lcd.setCursor(9,1);
-        lcd.print(newNAV1StandbyFreq,3);
+        fb.setCursor(0,0);
+        printFixed(fb, newCOM1ActiveFreq, 7, 3);
+        fb.setCursor(7,0);
+        fb.write(byte(1));
+        fb.setCursor(8,0);
+        fb.write(byte(2));
+        fb.setCursor(9,0);
+        printFixed(fb, shownValue(kCOM1StandbyFreq, newCOM1StandbyFreq), 7, 3);    
+        fb.setCursor(0,1);
+        printFixed(fb, newNAV1ActiveFreq, 7, 3);
+        fb.setCursor(7,1);
+        fb.write(byte(3));
+        fb.setCursor(8,1);
+        fb.write(byte(2));
+        fb.setCursor(9,1);
+        printFixed(fb, shownValue(kNAV1StandbyFreq, newNAV1StandbyFreq), 7, 3);
       }
       // --- COM2 o NAV2 ---
       if (sysSelect == 3 || sysSelect == 4) {
-        lcd.setCursor(0,0);
-        lcd.print(newCOM2ActiveFreq,3);
-        lcd.setCursor(7,0);
-        lcd.write(byte(1));
-        lcd.setCursor(8,0);
-        lcd.write(byte(4));
-        lcd.setCursor(9,0);
-        lcd.setCursor(9,0);
-        lcd.print(newCOM2StandbyFreq,3);    
-        lcd.setCursor(0,1);
-        lcd.print(newNAV2ActiveFreq,3);
-        lcd.setCursor(7,1);
-        lcd.write(byte(3));
-        lcd.setCursor(8,1);
-        lcd.write(byte(4));
-        lcd.setCursor(9,1);
-        lcd.print(newNAV2StandbyFreq,3);
+        fb.setCursor(0,0);
+        printFixed(fb, newCOM2ActiveFreq, 7, 3);
+        fb.setCursor(7,0);
+        fb.write(byte(1));
+        fb.setCursor(8,0);
+        fb.write(byte(4));
+        fb.setCursor(9,0);
+        fb.setCursor(9,0);
+        printFixed(fb, shownValue(kCOM2StandbyFreq, newCOM2StandbyFreq), 7, 3);    
+        fb.setCursor(0,1);
+        printFixed(fb, newNAV2ActiveFreq, 7, 3);
+        fb.setCursor(7,1);
+        fb.write(byte(3));
+        fb.setCursor(8,1);
+        fb.write(byte(4));
+        fb.setCursor(9,1);
+        printFixed(fb, shownValue(kNAV2StandbyFreq, newNAV2StandbyFreq), 7, 3);
       }
     }
 if (modeLCD == 1) {          // COM/COM
       // --- COM1 o COM2 ---
       if (sysSelect == 1 || sysSelect == 3) {
-        lcd.setCursor(0,0);
-        lcd.print(newCOM1ActiveFreq,3);
-        lcd.setCursor(7,0);
-        lcd.write(byte(1));
-        lcd.setCursor(8,0);
-        lcd.write(byte(2));
-        lcd.setCursor(9,0);
-        lcd.print(newCOM1StandbyFreq,3);    
-        lcd.setCursor(0,1);
-        lcd.print(newCOM2ActiveFreq,3);
-        lcd.setCursor(7,1);
-        lcd.write(byte(1));
-        lcd.setCursor(8,1);
-        lcd.write(byte(4));
-        lcd.setCursor(9,1);
-        lcd.print(newCOM2StandbyFreq,3);
+        fb.setCursor(0,0);
+        printFixed(fb, newCOM1ActiveFreq, 7, 3);
+        fb.setCursor(7,0);
+        fb.write(byte(1));
+        fb.setCursor(8,0);
+        fb.write(byte(2));
+        fb.setCursor(9,0);
+        printFixed(fb, shownValue(kCOM1StandbyFreq, newCOM1StandbyFreq), 7, 3);    
+        fb.setCursor(0,1);
+        printFixed(fb, newCOM2ActiveFreq, 7, 3);
+        fb.setCursor(7,1);
+        fb.write(byte(1));
+        fb.setCursor(8,1);
+        fb.write(byte(4));
+        fb.setCursor(9,1);
+        printFixed(fb, shownValue(kCOM2StandbyFreq, newCOM2StandbyFreq), 7, 3);
       }
       // --- NAV1 o NAV2 ---
       if (sysSelect == 2 || sysSelect == 4) {
-        lcd.setCursor(0,0);
-        lcd.print(newNAV1ActiveFreq,3);
-        lcd.setCursor(7,0);
-        lcd.write(byte(3));
-        lcd.setCursor(8,0);
-        lcd.write(byte(2));
-        lcd.setCursor(9,0);
-        lcd.setCursor(9,0);
-        lcd.print(newNAV1StandbyFreq,3);    
-        lcd.setCursor(0,1);
-        lcd.print(newNAV2ActiveFreq,3);
-        lcd.setCursor(7,1);
-        lcd.write(byte(3));
-        lcd.setCursor(8,1);
-        lcd.write(byte(4));
-        lcd.setCursor(9,1);
-        lcd.print(newNAV2StandbyFreq,3);
+        fb.setCursor(0,0);
+        printFixed(fb, newNAV1ActiveFreq, 7, 3);
+        fb.setCursor(7,0);
+        fb.write(byte(3));
+        fb.setCursor(8,0);
+        fb.write(byte(2));
+        fb.setCursor(9,0);
+        fb.setCursor(9,0);
+        printFixed(fb, shownValue(kNAV1StandbyFreq, newNAV1StandbyFreq), 7, 3);    
+        fb.setCursor(0,1);
+        printFixed(fb, newNAV2ActiveFreq, 7, 3);
+        fb.setCursor(7,1);
+        fb.write(byte(3));
+        fb.setCursor(8,1);
+        fb.write(byte(4));
+        fb.setCursor(9,1);
+        printFixed(fb, shownValue(kNAV2StandbyFreq, newNAV2StandbyFreq), 7, 3);
       }
     }
     // --- ADF ---
     if (sysSelect == 5) {
-      lcd.setCursor(0,0);
-      lcd.print(F("HDG"));
-      lcd.setCursor(6,0);
-      lcd.print(F("ADF"));
-      lcd.setCursor(12,0);
-      lcd.print(F("FREQ"));
-      lcd.setCursor(0,1);
-      lcd.print(newADFHDG,1);
-      if (newADFActiveFreq <= 999){
-        lcd.setCursor(11,1);
-        lcd.print(newADFActiveFreq,1);
-      } 
-      if (newADFActiveFreq >= 1000){
-        lcd.setCursor(10,1);
-        lcd.print(newADFActiveFreq,1);
-      }
+      fb.setCursor(0,0);
+      fb.print(F("HDG"));
+      fb.setCursor(6,0);
+      fb.print(F("ADF"));
+      fb.setCursor(12,0);
+      fb.print(F("FREQ"));
+      fb.setCursor(0,1);
+      fb.print(shownValue(kADFHDG, newADFHDG));
+      fb.setCursor(10,1);
+      printFixed(fb, shownValue(kADFActiveFreq, newADFActiveFreq), 6, 1);
     } 
     // --- XPNDR ---
     if (sysSelect == 6) {
       if(newIDENT == 0){
-        lcd.setCursor(5,0);
-        lcd.print(F("IDENT:"));
-        lcd.setCursor(7,1);
-        lcd.print(newXpndr);
+        fb.setCursor(5,0);
+        fb.print(F("IDENT:"));
+        fb.setCursor(7,1);
+        printFixed(fb, shownValue(kXpndr, newXpndr), 4, 0, '0');
       }
       if(newIDENT == 1) {
-        lcd.setCursor(1,0);
-        lcd.print(F("*** IDENT: ***"));
-        lcd.setCursor(7,1);
-        lcd.print(newXpndr);
+        fb.setCursor(1,0);
+        fb.print(F("*** IDENT: ***"));
+        fb.setCursor(7,1);
+        printFixed(fb, shownValue(kXpndr, newXpndr), 4, 0, '0');
       }
     }
 
@@ -285,46 +618,46 @@ if (modeLCD == 1) {          // COM/COM
     // --- Modo COM1/2 ---
     // ------ Khz ------
     if ((sysSelect == 1 ||sysSelect == 3) && freqSelMode == 0) {   
-      lcd.setCursor(15,0);
+      fb.setCursor(15,0);
     }
     // ------ Mhz ------
     if ((sysSelect == 1 ||sysSelect == 3) && freqSelMode == 1) {   
-      lcd.setCursor(11,0);
+      fb.setCursor(11,0);
     }
     // --- NAV1/2 ---
     // ------ Khz ------
     if ((sysSelect == 2 || sysSelect == 4) && freqSelMode == 0) {   
-      lcd.setCursor(15,1);
+      fb.setCursor(15,1);
     }
     // ------ Mhz ------
     if ((sysSelect == 2 || sysSelect == 4) && freqSelMode == 1) {   
-      lcd.setCursor(11,1);
+      fb.setCursor(11,1);
     }
     // --- ADF ---
     if (sysSelect == 5) {
       if (modeADF == 0){          // --- ADF Frecuency
         if (freqADF == 0){        // --- 0.1Khz
-          lcd.setCursor(15,1);
+          fb.setCursor(15,1);
         }
         if (freqADF == 1){        // --- 1Khz
-          lcd.setCursor(13,1);
+          fb.setCursor(13,1);
         }
         if (freqADF == 2){        // --- 10Khz
-          lcd.setCursor(12,1);
+          fb.setCursor(12,1);
         }
         if (freqADF == 3){        // --- 100Khz
-          lcd.setCursor(11,1);
+          fb.setCursor(11,1);
         }
       }
       if (modeADF == 1){          // --- ADF HDG
-        if (newADFHDG <=360){
-          lcd.setCursor(2,1);
+        if (shownValue(kADFHDG, newADFHDG) <=360){
+          fb.setCursor(2,1);
         }
-        if (newADFHDG <=99){
-          lcd.setCursor(1,1);
+        if (shownValue(kADFHDG, newADFHDG) <=99){
+          fb.setCursor(1,1);
         }
-        if (newADFHDG <=9){
-          lcd.setCursor(0,1);
+        if (shownValue(kADFHDG, newADFHDG) <=9){
+          fb.setCursor(0,1);
         }
       }
     } 
@@ -332,160 +665,508 @@ if (modeLCD == 1) {          // COM/COM
     if(sysSelect == 6) {
       // Selector decimal IDENT
       if (decIDENT == 1) {    // First
-        lcd.setCursor(10,1);
+        fb.setCursor(10,1);
       }
       if (decIDENT == 2) {    // Second
-        lcd.setCursor(9,1);
+        fb.setCursor(9,1);
       }
       if (decIDENT == 3) {    // Third
-        lcd.setCursor(8,1);
+        fb.setCursor(8,1);
       }
       if (decIDENT == 4) {    // Fourth
-        lcd.setCursor(7,1);
+        fb.setCursor(7,1);
       }
     }
   }
 // --- Configuration ---
   if (configMode == 1){
-    lcd.clear();
-    lcd.setCursor(0,0);
-    lcd.print(F("Mode:"));
-    lcd.setCursor(6, 0);
+    fb.setCursor(0,0);
+    fb.print(F("Mode:"));
+    fb.setCursor(6, 0);
     if (modeLCD == 0) {
-      lcd.print(F("COM/NAV"));
+      fb.print(F("COM/NAV"));
     }
     if (modeLCD == 1) {
-      lcd.print(F("COM/COM"));
+      fb.print(F("COM/COM"));
     }
     if (pwmset == false){
       iluminacion = iluminacionDef;
       contraste = contrasteDef;
     }
-    lcd.setCursor(0, 1);
-    lcd.print(F("LCD:"));
-    lcd.setCursor(4, 1);
-    lcd.print(iluminacion);
-    lcd.setCursor(8, 1);
-    lcd.print(F("Cont:"));
-    lcd.setCursor(13, 1);
-    lcd.print(contraste);
+    fb.setCursor(0, 1);
+    fb.print(F("LCD:"));
+    fb.setCursor(4, 1);
+    fb.print(iluminacion);
+    fb.setCursor(8, 1);
+    fb.print(F("Cont:"));
+    fb.setCursor(13, 1);
+    fb.print(contraste);
 
 // --- Cursor ---
     // CONFIG
     // (1)=Mode; (2)=Brightness; (3)=Contrast
     if (configState == 1){
-      lcd.setCursor(12,0);
+      fb.setCursor(12,0);
     }
     if (configState == 2){
-      lcd.setCursor(6,1);
+      fb.setCursor(6,1);
     }
     if (configState == 3){
-      lcd.setCursor(15,1);
+      fb.setCursor(15,1);
+    }
+  }
+
+// --- Queue only the changed cells for the panel ---
+  lcdSynced = fb.flush(lcd);
+}
+
+// ------------------ Render Scheduler ----------------
+// Mark the screen dirty. Several requests within one frame end in a single redraw.
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::requestRender(){
+  if (renderPending) {
+    renderSkipped++;
+  }
+  renderPending = true;
+}
+
+// Redraw the panels that show any of the channels
+void renderPanels(unsigned int channels){
+  for (uint8_t i = 0; i < panelCount; i++) {
+    if (panels[i]->screen() & channels) {
+      panels[i]->requestRender();
     }
   }
-  
+}
+
+template <class Encoder, class Display>
+unsigned int Panel<Encoder, Display>::screen() const {
+  return configMode ? 0 : screenOf(sysSelect);
+}
+
+// Sum of the generations of the channels on screen. Changes only when a shown value does.
+template <class Encoder, class Display>
+uint8_t Panel<Encoder, Display>::shownGeneration() const {
+  unsigned int shown = screen();
+  uint8_t generation = 0;
+  for (uint8_t i = 0; i < 12; i++) {
+    if (shown & (1U << i)) {
+      generation += channelGeneration[i];
+    }
+  }
+  return generation;
+}
+
+// Redraw when the screen is dirty and a frame interval has passed since the last one
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::renderScheduler(){
+  unsigned long now = millis();
+  uint8_t generation = shownGeneration();
+  if (generation != renderedGeneration) {
+    renderedGeneration = generation;
+    requestRender();
+  }
+  // Finish queueing a frame that did not fit in the LCD queue
+  if (!lcdSynced) {
+    lcdSynced = fb.flush(lcd);
+  }
+  if (!renderPending || now - lastRenderMs < frameInterval) {
+    return;
+  }
+  lastRenderMs = now;
+  renderPending = false;
+  renderCount++;
+  ScopeTimer timer(renderStats);
+  render();
+}
+
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::service(){
+  lcd.service(lcdSliceBytes);
+}
+
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::blank(){
+  fb.clear();
+  lcdSynced = fb.flush(lcd);
+}
+
+// ------------------ Statistics ----------------
+void sendHistogram(const __FlashStringHelper* name, LatencyHistogram& histogram){
+  messenger.sendCmdArg(name);
+  messenger.sendCmdArg(histogram.samples());
+  messenger.sendCmdArg(histogram.percentile(50));
+  messenger.sendCmdArg(histogram.percentile(99));
+  messenger.sendCmdArg(histogram.maximum());
+}
+
+// The STATS reply is one frame per section, sent by statsScheduler() as the outbound queue
+// has room: "STATS,LOOP,n,p50,p99,max;", then RENDER, CALLBACK and INPUT the same way,
+// "STATS,ENC,overflows;", "STATS,BYTES,in/s,out/s;", "STATS,FRAMES,drawn,merged;",
+// "STATS,UPDATES,changed,unchanged,offscreen;", "STATS,PREDICT,hits,misses;",
+// "STATS,TX,queued,merged,dropped,stalls;", "STATS,LINK,baud,corrupt,lost,fallbacks;",
+// "STATS,RAM,boot,headroom;" and "STATS,TASKS,name,runs,overruns,max;" for each task.
+// Times in us. Each section is reset for the next window once sent.
+enum StatsSection : uint8_t {
+  statsLoop,
+  statsRender,
+  statsCallback,
+  statsInput,
+  statsEnc,
+  statsBytes,
+  statsFrames,
+  statsUpdates,
+  statsPredict,
+  statsTx,
+  statsLink,
+  statsRam,
+  statsTasks                    // One section per task from here
+};
+
+void sendStats(byte cmdId){
+  // A reply under way answers this request too
+  if (statsNext != statsIdle) {
+    return;
+  }
+  statsCmdId = cmdId;
+  statsNext = statsLoop;
+  statsScheduler();
+}
+
+// Returns false after the last section
+bool sendStatsSection(uint8_t section){
+  switch (section) {
+  case statsLoop:
+    sendHistogram(F("LOOP"), loopStats);
+    loopStats.reset();
+    return true;
+  case statsRender:
+    sendHistogram(F("RENDER"), renderStats);
+    renderStats.reset();
+    return true;
+  case statsCallback:
+    sendHistogram(F("CALLBACK"), callbackStats);
+    callbackStats.reset();
+    return true;
+  case statsInput:
+    sendHistogram(F("INPUT"), inputStats);
+    inputStats.reset();
+    return true;
+  case statsEnc: {
+    unsigned int overflows = 0;
+    for (uint8_t i = 0; i < panelCount; i++) {
+      overflows += panels[i]->overflows();
+    }
+    messenger.sendCmdArg(F("ENC"));
+    messenger.sendCmdArg(overflows);
+    return true;
+  }
+  case statsBytes: {
+    unsigned long now = millis();
+    unsigned long window = now - lastStatsMs;
+    if (window == 0) {
+      window = 1;
+    }
+    messenger.sendCmdArg(F("BYTES"));
+    messenger.sendCmdArg(link.bytesIn * 1000UL / window);
+    messenger.sendCmdArg(link.bytesOut * 1000UL / window);
+    link.bytesIn = 0;
+    link.bytesOut = 0;
+    lastStatsMs = now;
+    return true;
+  }
+  case statsFrames:
+    messenger.sendCmdArg(F("FRAMES"));
+    messenger.sendCmdArg(renderCount);
+    messenger.sendCmdArg(renderSkipped);
+    renderCount = 0;
+    renderSkipped = 0;
+    return true;
+  case statsUpdates:
+    messenger.sendCmdArg(F("UPDATES"));
+    messenger.sendCmdArg(updatesChanged);
+    messenger.sendCmdArg(updatesUnchanged);
+    messenger.sendCmdArg(updatesOffscreen);
+    updatesChanged = 0;
+    updatesUnchanged = 0;
+    updatesOffscreen = 0;
+    return true;
+  case statsPredict:
+    messenger.sendCmdArg(F("PREDICT"));
+    messenger.sendCmdArg(predictHits);
+    messenger.sendCmdArg(predictMisses);
+    predictHits = 0;
+    predictMisses = 0;
+    return true;
+  case statsTx:
+    messenger.sendCmdArg(F("TX"));
+    messenger.sendCmdArg(serialLink.highWater);
+    messenger.sendCmdArg(serialLink.merged);
+    messenger.sendCmdArg(serialLink.dropped);
+    messenger.sendCmdArg(serialLink.stalls);
+    return true;
+  case statsLink:
+    messenger.sendCmdArg(F("LINK"));
+    messenger.sendCmdArg(baudNow);
+    messenger.sendCmdArg(serialLink.corrupt);
+    messenger.sendCmdArg(serialLink.lost);
+    messenger.sendCmdArg(baudFallbacks);
+    baudFallbacks = 0;
+    serialLink.resetStats();
+    return true;
+  case statsRam:
+    messenger.sendCmdArg(F("RAM"));
+    messenger.sendCmdArg(ramAtBoot);
+    messenger.sendCmdArg(ramHeadroom());
+    return true;
+  default:
+    return sendTaskStats(section - statsTasks);
+  }
+}
+
+// The sections of the STATS reply under way, each once the outbound queue has room for it
+void statsScheduler(){
+  while (statsNext != statsIdle && serialLink.room() >= SerialLink::kMaxFrame) {
+    messenger.sendCmdStart(statsCmdId);
+    messenger.sendCmdArg(F("STATS"));
+    bool more = sendStatsSection(statsNext);
+    messenger.sendCmdEnd();
+    statsNext = more ? statsNext + 1 : statsIdle;
+  }
 }
 
 // --------------------------- Apply Configuration ---------------------------------
 
+// Apply the new values now, EEPROM is written later by saveSettings() and eepromTask()
 void applyConfig(){
-  if (pwmset == false){
-    analogWrite(luzPin, iluminacion);
-    analogWrite(contrastePin, contraste);
-    EEPROM.write(0, iluminacion);
-    EEPROM.write(1, contraste);
+  analogWrite(luzPin, iluminacion);
+  analogWrite(contrastePin, contraste);
+  pwmset = true;
+  settingsDirty = true;
+  settingsChangedMs = millis();
+}
+
+void saveSettings(){
+  if (!settingsDirty) {
+    return;
+  }
+  Settings settings;
+  settings.brightness = iluminacion;
+  settings.contrast = contraste;
+  settings.displayMode = modeLCD;
+  settingsStore.save(settings);
+  settingsDirty = false;
+}
+
+// Save once the user stopped changing settings, in case config mode is never left
+void settingsScheduler(){
+  if (settingsDirty && millis() - settingsChangedMs >= settingsIdleMs) {
+    saveSettings();
+  }
+}
+
+void loadSettings(){
+  Settings settings;
+  if (settingsStore.load(settings)) {
+    iluminacion = settings.brightness;
+    contraste = settings.contrast;
+    modeLCD = settings.displayMode;
     pwmset = true;
-    return;    
   } else {
-    analogWrite(luzPin, iluminacion);
-    analogWrite(contrastePin, contraste);
-    EEPROM.write(0, iluminacion);
-    EEPROM.write(1, contraste);
-    pwmset = true;
-    return;
+    iluminacion = iluminacionDef;
+    contraste = contrasteDef;
   }
+  analogWrite(luzPin, iluminacion);
+  analogWrite(contrastePin, contraste);
 }
 
 
 // ------------------  C A L L B A C K S  F U N C T I O N S -----------------------
 
+// Read a decimal argument as fixed point with the given number of decimals. A missing
+// argument reads as 0, like readDoubleArg().
+long readFixedArg(uint8_t decimals){
+  const char* arg = messenger.readStringArg();
+  return arg == NULL ? 0 : parseFixed(arg, decimals);
+}
+
+// Record an inbound value. Returns true when it differs from the one held (or is the
+// first since the subscription), which moves the channel to its next generation.
+bool channelChanged(int channel, long held, long received){
+  unsigned int bit = channelBit(channel);
+  reconcilePrediction(channel, received);
+  // 8.33 Khz channel names are not on the 25 Khz raster
+  if ((channel == kCOM1ActiveFreq || channel == kCOM1StandbyFreq ||
+       channel == kCOM2ActiveFreq || channel == kCOM2StandbyFreq) && received % 25 != 0) {
+    com833 = true;
+  }
+  if ((channelsSeen & bit) && held == received) {
+    updatesUnchanged++;
+    return false;
+  }
+  channelsSeen |= bit;
+  channelGeneration[channel - kADFActiveFreq]++;
+  updatesChanged++;
+  unsigned int shown = 0;
+  for (uint8_t i = 0; i < panelCount; i++) {
+    shown |= panels[i]->screen();
+  }
+  if (!(shown & bit)) {
+    updatesOffscreen++;
+  }
+  return true;
+}
+
+// Store a received value in its container unless it is the one held
+template <class T>
+void receiveValue(int channel, T& held, long value){
+  if (channelChanged(channel, held, value)) {
+    held = value;
+  }
+}
+
 void onADFActiveFreq(){
-  newADFActiveFreq = messenger.readFloatArg();
-  printLCD();
-  return;  
+  receiveValue(kADFActiveFreq, newADFActiveFreq, readFixedArg(1));
 }
 
 void onnewADFHDG(){
-  newADFHDG = messenger.readInt16Arg();
-  printLCD();
-  return;
+  receiveValue(kADFHDG, newADFHDG, messenger.readInt16Arg());
 }
 
 void onCOM1ActiveFreq(){
-  newCOM1ActiveFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kCOM1ActiveFreq, newCOM1ActiveFreq, readFixedArg(3));
 }
 
 void onCOM1StandbyFreq(){
-  newCOM1StandbyFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kCOM1StandbyFreq, newCOM1StandbyFreq, readFixedArg(3));
 }
 
 void onNAV1ActiveFreq(){
-  newNAV1ActiveFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kNAV1ActiveFreq, newNAV1ActiveFreq, readFixedArg(3));
 }
 
 void onNAV1StandbyFreq(){
-  newNAV1StandbyFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kNAV1StandbyFreq, newNAV1StandbyFreq, readFixedArg(3));
 }
 
 void onCOM2ActiveFreq(){
-  newCOM2ActiveFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kCOM2ActiveFreq, newCOM2ActiveFreq, readFixedArg(3));
 }
 
 void onCOM2StandbyFreq(){
-  newCOM2StandbyFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kCOM2StandbyFreq, newCOM2StandbyFreq, readFixedArg(3));
 }
 
 void onNAV2ActiveFreq(){
-  newNAV2ActiveFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kNAV2ActiveFreq, newNAV2ActiveFreq, readFixedArg(3));
 }
 
 void onNAV2StandbyFreq(){
-  newNAV2StandbyFreq = messenger.readFloatArg();
-  printLCD();
-  return;
+  receiveValue(kNAV2StandbyFreq, newNAV2StandbyFreq, readFixedArg(3));
 }
 
 void onXpndr(){
-  newXpndr = messenger.readInt16Arg();
-  printLCD();
-  return;
+  receiveValue(kXpndr, newXpndr, messenger.readInt16Arg());
 }
 
 void onIDENT(){
-  newIDENT = messenger.readBoolArg();
-  printLCD();
-  return;
+  receiveValue(kIDENT, newIDENT, messenger.readBoolArg());
+}
+
+// Batched values from hosts that sent "0,CONFIG,BINARY;": 22,<v>,<v>,...; where each v is
+// a CmdMessenger binary int32 (4 bytes, little endian, escaped) holding the data channel in
+// the top byte and the value in the low 24 bits, sign extended, in the fixed point of its
+// container (COM/NAV Khz, ADF 0.1 Khz). One command and no text parsing for a whole burst.
+// readBinArg() does not set isArgOk(), available() looks at the next field without taking it.
+void onValues(){
+  while (messenger.available()) {
+    int32_t packed = messenger.readBinArg<int32_t>();
+    int channel = (uint32_t)packed >> 24;
+    long value = (long)((uint32_t)packed << 8) >> 8;
+    switch (channel) {
+    case kADFActiveFreq: receiveValue(channel, newADFActiveFreq, value); break;
+    case kCOM1ActiveFreq: receiveValue(channel, newCOM1ActiveFreq, value); break;
+    case kCOM1StandbyFreq: receiveValue(channel, newCOM1StandbyFreq, value); break;
+    case kNAV1ActiveFreq: receiveValue(channel, newNAV1ActiveFreq, value); break;
+    case kNAV1StandbyFreq: receiveValue(channel, newNAV1StandbyFreq, value); break;
+    case kCOM2ActiveFreq: receiveValue(channel, newCOM2ActiveFreq, value); break;
+    case kCOM2StandbyFreq: receiveValue(channel, newCOM2StandbyFreq, value); break;
+    case kNAV2ActiveFreq: receiveValue(channel, newNAV2ActiveFreq, value); break;
+    case kNAV2StandbyFreq: receiveValue(channel, newNAV2StandbyFreq, value); break;
+    case kADFHDG: receiveValue(channel, newADFHDG, value); break;
+    case kXpndr: receiveValue(channel, newXpndr, value); break;
+    case kIDENT: receiveValue(channel, newIDENT, value); break;
+    default: break;
+    }
+  }
 }
 
 
 // ---------------------- E N C O D E R B U T T O N  C A L L B A C K S --------------------------
 
+// EncoderButton handlers are plain functions: the user id of the button picks its panel
+RadioPanel& panelOf(EncoderButton& eb) {
+  return *panels[eb.userId()];
+}
+
+void onButtonClicked(EncoderButton& eb) {
+  panelOf(eb).onClicked();
+}
+
+void onButtonLongClick(EncoderButton& eb) {
+  panelOf(eb).onLongClick();
+}
+
+void onButtonDoubleClick(EncoderButton& eb) {
+  panelOf(eb).onDoubleClick();
+}
+
+void onButtonTripleClick(EncoderButton& eb) {
+  panelOf(eb).onTripleClick();
+}
+
+// -------------------------------------- Gestures ---------------------------------------
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::press(uint8_t gesture) {
+  deferredGesture = gesture;
+  runGesture();
+}
+
+// Steps turned so far are in the unit selected until now, they go out first. While the queue
+// has no room for them the gesture waits, and the knob and button wait for the gesture.
+// Returns false while it waits.
+template <class Encoder, class Display>
+bool Panel<Encoder, Display>::runGesture() {
+  if (!sendHeldSteps(true)) {
+    return false;
+  }
+  // The standby target has to reach the sim before the swap, then the swap needs room
+  if (deferredGesture == gestureLongClick &&
+      (!flushSetEvent() || serialLink.room() < SerialLink::kMaxFrame)) {
+    return false;
+  }
+  uint8_t gesture = deferredGesture;
+  deferredGesture = gestureNone;
+  switch (gesture) {
+  case gestureClick:
+    clicked();
+    break;
+  case gestureLongClick:
+    longClicked();
+    break;
+  case gestureDoubleClick:
+    doubleClicked();
+    break;
+  case gestureTripleClick:
+    tripleClicked();
+    break;
+  }
+  return true;
+}
+
 // -------------------------------------- One Short Click ---------------------------------------
-void onEb1Clicked(EncoderButton& eb) {
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::clicked() {
 // --- ADF Mode---
   if (sysSelect == 5){
 // --- ADF Frequency ---
@@ -494,7 +1175,7 @@ void onEb1Clicked(EncoderButton& eb) {
       if (freqADF == 4){
         freqADF = 0;
       }
-      printLCD();
+      requestRender();
       return;
     }
 // --- ADF Heading ---
@@ -508,303 +1189,597 @@ void onEb1Clicked(EncoderButton& eb) {
     if (decIDENT == 5){
       decIDENT = 1;
     }
-    printLCD();
+    requestRender();
     return;
   }
   if (configMode == true) {
     configState++;
-    printLCD();
     if (configState == 4){
      configState = 1;
-     printLCD();
     }
+    requestRender();
   }
 // --- Else ---
   else {
   freqSelMode = !freqSelMode;
-  printLCD();
+  requestRender();
   return;
   }
 }
 
 // --------------------------------- One Long Click | ACTIVE SWAP ------------------------------------------
-void onEb1LongClick(EncoderButton& eb) {
-// --- COM1 ---
-  if (sysSelect == 1) {
-    messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM1_RADIO_SWAP")));
-    messenger.sendCmdEnd();
-    printLCD();
-    return;
-  }
-// --- NAV1 ---
-  if (sysSelect == 2) {
-    messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV1_RADIO_SWAP")));
-    messenger.sendCmdEnd();
-    printLCD();
-    return;
-  }
-// --- COM2 ---
-  if (sysSelect == 3) {
-    messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM2_RADIO_SWAP")));
-    messenger.sendCmdEnd();
-    printLCD();
-    return;
-  }
-// --- NAV2 ---
-  if (sysSelect == 4) {
-    messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV2_RADIO_SWAP")));
-    messenger.sendCmdEnd();
-    printLCD();
-    return;
-  }
-  // --- ADF ---  
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::longClicked() {
+// --- ADF: toggle frequency / heading ---
   if (sysSelect == 5) {
     modeADF = !modeADF;
-    printLCD();
-    return;
-  }
-  // --- If in XPNDR, send IDENT ---  
-  if (sysSelect == 6) {
-    messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_IDENT_ON")));
-    messenger.sendCmdEnd();
-    printLCD();
+    requestRender();
     return;
   }
+// --- COM/NAV swap, XPNDR IDENT ---
+  sendSimEvent(pgm_read_byte(&longClickEvents[sysSelect - 1]));
+  requestRender();
 }
 
 // ----------------------------------------- Double Click | Switch Systems -----------------------------------------
-void onEb1DoubleClick(EncoderButton& eb) {
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::doubleClicked() {
   sysSelect = sysSelect + 1;
   if (sysSelect == 7) {
     sysSelect = 1;
   }
-  printLCD();
+  requestRender();
   return;
 }
 
 // ------------------------------------------ Triple Click | Config Mode ------------------------------------------
-void onEb1TripleClick(EncoderButton& eb) {
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::tripleClicked() {
   configMode = !configMode;
-  printLCD();
+  if (!configMode) {
+    saveSettings();
+  }
+  requestRender();
   return;
 }
 
 // ------------------------------------------ Encoder rotation ------------------------------------------
-void onEb1Encoder(EncoderButton& eb) {
-// freqSelMode Mode selector: (0) = Khz; (1) = Mhz; --- Default: Khz ---
-// sysSelect System Selector: (1)=COM1; (2)=NAV1; (3)=COM2; (4)=NAV2;(5)=ADF; (6)=XPNDR;  --- Default: COM1 ---
-//
-// --- Increase ---
-  if (eb.increment() == 1) {
-    if (sysSelect == 5) {          // --- ADF
-      if (modeADF == 0) {          // --- ADF Frecuency Mode
-        if (freqADF == 0) {        // --- 0.1Khz 
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_FRACT_INC_CARRY")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 1){        // --- 1Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_1_INC")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 2){        // --- 10Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_10_INC")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 3){        // --- 100Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_100_INC")));
-          messenger.sendCmdEnd();
-        }
-      }
-      if (modeADF == 1){          // --- Modo ADF HDG
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_CARD_INC")));
-          messenger.sendCmdEnd();
-      }
-    }
-    // COM1 Khz    
-    if (freqSelMode == 0 && sysSelect == 1) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM_RADIO_FRACT_INC_CARRY")));
-      messenger.sendCmdEnd();
-    }
-    // COM1 Mhz
-    if (freqSelMode == 1 && sysSelect == 1) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM_RADIO_WHOLE_INC")));
-      messenger.sendCmdEnd();
-    }
-    // NAV1 Khz
-    if (freqSelMode == 0 && sysSelect == 2) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV1_RADIO_FRACT_INC")));
-      messenger.sendCmdEnd();
-    }
-    // NAV1 Mhz
-    if (freqSelMode == 1 && sysSelect == 2) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV1_RADIO_WHOLE_INC")));
-      messenger.sendCmdEnd();
+// The detents the encoder ISR queued since the last pass, sent as one batch, then the button:
+// the steps turned before a press go out before what the press does
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::update() {
+  if (deferredGesture != gestureNone && !runGesture()) {
+    return;
+  }
+  readEncoder();
+  sendEncoderBatch();
+  button.update();
+}
+
+// Take the detents the encoder ISR queued since the last pass
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::readEncoder() {
+  EncoderStep step;
+  while (knob.read(step)) {
+    inputStats.add(micros() - step.us);
+    onEncoderStep(step);
+  }
+}
+
+// Velocity: a detent less than 1/accelRate s after the previous one goes to the next coarser unit.
+// The time comes from the ISR, so it does not depend on how busy loop() was.
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::onEncoderStep(const EncoderStep& step) {
+  int steps = step.dir;
+  unsigned long dt = step.us - lastStepUs;
+  lastStepUs = step.us;
+  bool fast = dt <= 1000000UL / accelRate;
+
+  // CONFIG
+  if (configMode == 1) {
+    // (1)=Screen Mode; (2)=Brightness; (3)=Contrast
+    if (configState == 1 && (steps & 1)){
+      modeLCD = !modeLCD;
+      settingsDirty = true;
+      settingsChangedMs = millis();
+      // The other panels show the new layout
+      renderPanels(~0U);
     }
-    // COM2 Khz
-    if (freqSelMode == 0 && sysSelect == 3) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM2_RADIO_FRACT_INC_CARRY")));
-      messenger.sendCmdEnd();
+    if (fast) {
+      steps *= accelConfigStep;
     }
-    // COM2 Mhz
-    if (freqSelMode == 1 && sysSelect == 3) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM2_RADIO_WHOLE_INC")));
-      messenger.sendCmdEnd();
+    if (configState == 2){
+      iluminacion += steps;
+      applyConfig();
     }
-    // NAV2 Khz
-    if (freqSelMode == 0 && sysSelect == 4) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV2_RADIO_FRACT_INC")));
-      messenger.sendCmdEnd();
+    if (configState == 3){
+      contraste += steps;
+      applyConfig();
     }
-    // NAV2 Mhz
-    if (freqSelMode == 1 && sysSelect == 4) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV2_RADIO_WHOLE_INC")));
-      messenger.sendCmdEnd();
+    requestRender();
+    return;
+  }
+
+  // Radios: collect the net change, it is sent once per loop() by sendEncoderBatch()
+  if (fast) {
+    pendingCoarse += steps;
+  } else {
+    pendingFine += steps;
+  }
+}
+
+// ------------------------------------------ Selected unit ------------------------------------------
+// Sub-mode the knob changes in the selected system, see rotationEvents. Coarse is the next bigger one.
+template <class Encoder, class Display>
+int Panel<Encoder, Display>::selectedUnit(bool coarse) const {
+  int unit;
+  if (sysSelect <= 4) {
+    unit = freqSelMode;
+  } else if (sysSelect == 5) {
+    unit = modeADF ? 4 : freqADF;
+  } else {
+    unit = decIDENT - 1;
+  }
+  if (coarse && unit < pgm_read_byte(&coarseLimit[sysSelect - 1])) {
+    unit++;
+  }
+  return unit;
+}
+
+// ------------------------------------------ Sim events ------------------------------------------
+// Sim events take the urgent lane, ahead of subscriptions, alias lines and stats
+void sendSimEvent(uint8_t event) {
+  if (event == evNone) {
+    return;
+  }
+  serialLink.urgentNext();
+  if (aliasesOn) {
+    messenger.sendCmd(kAliasCommand, event);
+    return;
+  }
+  messenger.sendCmd(kSimCommand, simEventName(event));
+}
+
+// Bind every event to its SimEvent id: "1,ALIAS,<id>,SIMCONNECT:<name>;"
+// From then on "9,<id>;" replaces "4,SIMCONNECT:<name>;", 5 bytes instead of ~40.
+// Sent as the outbound queue has room. Events go ahead of queued lines, so the aliases are
+// used once all the lines have left the queue.
+void aliasScheduler() {
+  if (aliasNext == evNone) {
+    return;
+  }
+  while (aliasNext < evCount && serialLink.room() >= SerialLink::kMaxFrame) {
+    messenger.sendCmdStart(kCommand);
+    messenger.sendCmdArg(F("ALIAS"));
+    messenger.sendCmdArg(aliasNext);
+    messenger.sendCmdArg(simEventName(aliasNext));
+    messenger.sendCmdEnd();
+    aliasNext++;
+  }
+  if (aliasNext == evCount && serialLink.pending() == 0) {
+    aliasesOn = true;
+    aliasNext = evNone;
+  }
+}
+
+// INIT, BAUD and PING answers take the urgent lane, SPAD.neXt times them out. Each waits
+// until the outbound queue has room for it, BAUD after INIT.
+void handshakeScheduler() {
+  if (initReplyPending && serialLink.room() >= SerialLink::kMaxFrame) {
+    serialLink.urgentNext();
+    messenger.sendCmdStart(kRequest);
+    messenger.sendCmdArg(F("SPAD"));
+    messenger.sendCmdArg(F("{9d6440d1-3d36-4f2c-884d-1d4bc2cde171}"));
+    messenger.sendCmdArg(F("One Knob Radio_FS20 v1.0"));
+    messenger.sendCmdEnd();
+    initReplyPending = false;
+  }
+  if (!initReplyPending && baudReplyRate != 0 && serialLink.room() >= SerialLink::kMaxFrame) {
+    serialLink.urgentNext();
+    messenger.sendCmdStart(kRequest);
+    messenger.sendCmdArg(F("BAUD"));
+    messenger.sendCmdArg(baudReplyRate);
+    messenger.sendCmdEnd();
+    baudNext = baudReplyRate != baudNow ? baudReplyRate : 0;
+    baudReplyRate = 0;
+  }
+  if (pongPending && serialLink.room() >= SerialLink::kMaxFrame) {
+    serialLink.urgentNext();
+    messenger.sendCmdStart(kRequest);
+    messenger.sendCmdArg(F("PONG"));
+    messenger.sendCmdArg(pongValue);
+    messenger.sendCmdEnd();
+    pongPending = false;
+  }
+}
+
+// "0,CONFIG;" closes the configuration, so it goes in the normal lane once the initial
+// subscriptions and alias lines are all queued. BINARY tells the host kValues is understood.
+void configScheduler() {
+  if (!configReplyPending || serialLink.room() < SerialLink::kMaxFrame) {
+    return;
+  }
+  if (subscribedChannels != wantedChannels() && !configuring()) {
+    return;
+  }
+  if (aliasNext != evNone && aliasNext < evCount) {
+    return;
+  }
+  messenger.sendCmdStart(kRequest);
+  messenger.sendCmdArg(F("CONFIG"));
+  if (configReplyBinary) {
+    messenger.sendCmdArg(F("BINARY"));
+  }
+  messenger.sendCmdEnd();
+  configReplyPending = false;
+}
+
+// Switch the serial rate once the frames queued before the switch are on the wire, at the
+// old rate. Fall back to baseBaud while no good frame comes at the fast one.
+void baudScheduler() {
+  if (baudNext != 0) {
+    if (serialLink.pending() > 0 || Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1) {
+      return;
     }
-    // XPNDR
-    if (sysSelect == 6) {
-     // ----  XPNDR code Increase -----
-     // XPNDR position Selector
-      if (decIDENT == 1) {    // First
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_1_INC")));
-        messenger.sendCmdEnd();        
-      }
-      if (decIDENT == 2) {    // Second
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_10_INC")));
-        messenger.sendCmdEnd();
-      }
-      if (decIDENT == 3) {    // Third
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_100_INC")));
-        messenger.sendCmdEnd();
-      }
-      if (decIDENT == 4) {    // Fourth
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_1000_INC")));
-        messenger.sendCmdEnd();        
-      }
+    Serial.flush();               // The last byte shifting out
+    Serial.begin(baudNext);
+    baudNow = baudNext;
+    baudNext = 0;
+    serialLink.setFraming(baudNow != baseBaud);
+    baudConfirmed = false;
+    baudFramesSeen = 0;
+    baudSinceMs = millis();
+    return;
+  }
+  if (baudNow == baseBaud) {
+    return;
+  }
+  unsigned long now = millis();
+  if (serialLink.framesIn() != baudFramesSeen) {
+    baudFramesSeen = serialLink.framesIn();
+    baudConfirmed = true;
+    baudSinceMs = now;
+  } else if (now - baudSinceMs >= (baudConfirmed ? baudSilenceMs : baudConfirmMs)) {
+    baudNext = baseBaud;
+    baudFallbacks++;
+  }
+}
+
+// Send one INC/DEC event for the selected system and sub-mode
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::sendRotationEvent(bool increase, int unit) {
+  sendSimEvent(pgm_read_byte(&rotationEvents[sysSelect - 1][unit][increase]));
+}
+
+// ------------------------------------------ Encoder batch ------------------------------------------
+// Send the steps collected during this loop() pass, opposite turns cancel out.
+// In SET mode they move the local target instead, see setScheduler().
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::sendEncoderBatch() {
+  if (pendingCoarse == 0 && pendingFine == 0) {
+    sendHeldSteps(false);
+    return;
+  }
+  int channel = editChannel();
+  bool known = channelsSeen & channelBit(channel);
+  // SET mode: the steps sent before the value was known go first, the batch waits for them
+  if (modeSET && known && !sendHeldSteps(true)) {
+    return;
+  }
+  if (known) {
+    // A target for another channel goes out first, the batch waits for room for it
+    if (channel != setChannel && !flushSetEvent()) {
+      return;
     }
-    // CONFIG
-    if(configMode == 1) {
-      // (1)=Screen Mode; (2)=Brightness; (3)=Contrast
-      if (configState == 1){
-        modeLCD = !modeLCD;
-        printLCD();
-      }
-      if (configState == 2){
-        iluminacion++;
-        applyConfig();
-        printLCD();
-      }
-      if (configState == 3){
-        contraste++;
-        applyConfig();
-        printLCD();
-      }
+    predictSteps(channel, pendingCoarse, selectedUnit(true), pendingFine, selectedUnit(false));
+  }
+  // SET mode: the prediction is the target
+  if (modeSET && known) {
+    setChannel = channel;
+    setTarget = predictValue;
+    pendingCoarse = 0;
+    pendingFine = 0;
+    setPending = true;
+    lastSetStepMs = millis();
+    return;
+  }
+  heldCoarse += pendingCoarse;
+  heldFine += pendingFine;
+  pendingCoarse = 0;
+  pendingFine = 0;
+  sendHeldSteps(false);
+}
+
+// INC/DEC events wait here while the link still has sim events queued, as one net count
+// per unit: a fast spin or a turn back merges instead of piling up events that a
+// swap would have to wait for. all: send them as the queue has room even behind other
+// sim events, before a button changes what they mean. Returns true when none is left.
+template <class Encoder, class Display>
+bool Panel<Encoder, Display>::sendHeldSteps(bool all) {
+  while (heldCoarse != 0 && (all || serialLink.urgentPending() == 0) &&
+         serialLink.room() >= SerialLink::kMaxFrame) {
+    bool increase = heldCoarse > 0;
+    sendRotationEvent(increase, selectedUnit(true));
+    heldCoarse += increase ? -1 : 1;
+  }
+  while (heldFine != 0 && (all || serialLink.urgentPending() == 0) &&
+         serialLink.room() >= SerialLink::kMaxFrame) {
+    bool increase = heldFine > 0;
+    sendRotationEvent(increase, selectedUnit(false));
+    heldFine += increase ? -1 : 1;
+  }
+  return heldCoarse == 0 && heldFine == 0;
+}
+
+// ------------------------------------------ Absolute SET mode ------------------------------------------
+// Data channel the knob edits in the selected system
+template <class Encoder, class Display>
+int Panel<Encoder, Display>::editChannel() const {
+  if (sysSelect == 1) {
+    return kCOM1StandbyFreq;
+  }
+  if (sysSelect == 2) {
+    return kNAV1StandbyFreq;
+  }
+  if (sysSelect == 3) {
+    return kCOM2StandbyFreq;
+  }
+  if (sysSelect == 4) {
+    return kNAV2StandbyFreq;
+  }
+  if (sysSelect == 5) {
+    return modeADF ? kADFHDG : kADFActiveFreq;
+  }
+  return kXpndr;
+}
+
+// Last received value: COM/NAV in Khz, ADF in 0.1 Khz, HDG in degrees, XPNDR code
+long channelValue(int channel) {
+  if (channel == kCOM1StandbyFreq) return newCOM1StandbyFreq;
+  if (channel == kCOM2StandbyFreq) return newCOM2StandbyFreq;
+  if (channel == kNAV1StandbyFreq) return newNAV1StandbyFreq;
+  if (channel == kNAV2StandbyFreq) return newNAV2StandbyFreq;
+  if (channel == kADFActiveFreq) return newADFActiveFreq;
+  if (channel == kADFHDG) return newADFHDG;
+  return newXpndr;
+}
+
+// Wrap v into [lo, hi)
+long wrapRange(long v, long lo, long hi) {
+  long span = hi - lo;
+  v = (v - lo) % span;
+  if (v < 0) {
+    v += span;
+  }
+  return v + lo;
+}
+
+// 8.33 Khz channel names in each 100 Khz block. The 25 Khz ones (.000, .025, ...) are included.
+const uint8_t com833Names[16] PROGMEM = { 0, 5, 10, 15, 25, 30, 35, 40, 50, 55, 60, 65, 75, 80, 85, 90 };
+
+// Step through the 8.33 Khz channel names with carry, 118.000 - 136.990
+long stepCom833(long value, int steps) {
+  uint8_t khz = value % 100;
+  uint8_t name = 0;
+  for (uint8_t i = 1; i < 16; i++) {
+    if (pgm_read_byte(&com833Names[i]) <= khz) {
+      name = i;
     }
   }
+  long index = wrapRange(value / 100 * 16 + name + steps, 1180L * 16, 1370L * 16);
+  return index / 16 * 100 + pgm_read_byte(&com833Names[index % 16]);
+}
 
-  // --- Decrease ---
-  if (eb.increment() == -1) {
-    if (sysSelect == 5) {         // --- ADF
-      if (modeADF == 0) {         // --- ADF Frecuency Mode
-        if (freqADF == 0){        // --- 0.1Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_FRACT_DEC_CARRY")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 1){        // --- 1Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_1_DEC")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 2){        // --- 10Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_10_DEC")));
-          messenger.sendCmdEnd();
-        }
-        if (freqADF == 3){        // --- 100Khz
-          messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_100_DEC")));
-          messenger.sendCmdEnd();
-        }
-      }
-      if (modeADF == 1){          // --- ADF HDG
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:ADF_CARD_DEC")));
-        messenger.sendCmdEnd();
+// Apply knob steps to a channel value with the same rules as the sim INC/DEC events
+long stepChannel(int channel, long value, int steps, int unit) {
+  if (steps == 0) {
+    return value;
+  }
+  // --- COM: 25 Khz (or 8.33 Khz) with carry into Mhz, 118.000 - 136.975 ---
+  if (channel == kCOM1StandbyFreq || channel == kCOM2StandbyFreq) {
+    if (unit == 0) {
+      if (com833) {
+        return stepCom833(value, steps);
       }
-    }    
-    // COM1 Khz
-    if (freqSelMode == 0 && sysSelect == 1) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM_RADIO_FRACT_DEC_CARRY")));
-      messenger.sendCmdEnd();
-    }
-    // COM1 Mhz
-    if (freqSelMode == 1 && sysSelect == 1) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM_RADIO_WHOLE_DEC")));
-      messenger.sendCmdEnd();
-    }
-    // NAV1 Khz
-    if (freqSelMode == 0 && sysSelect == 2) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV1_RADIO_FRACT_DEC")));
-      messenger.sendCmdEnd();
+      return wrapRange(value + steps * 25L, 118000, 137000);
     }
-    // NAV1 Mhz
-    if (freqSelMode == 1 && sysSelect == 2) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV1_RADIO_WHOLE_DEC")));
-      messenger.sendCmdEnd();
-    }
-    // COM2 Khz
-    if (freqSelMode == 0 && sysSelect == 3) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM2_RADIO_FRACT_DEC_CARRY")));
-      messenger.sendCmdEnd();
-    }
-    // COM2 Mhz
-    if (freqSelMode == 1 && sysSelect == 3) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:COM2_RADIO_WHOLE_DEC")));
-      messenger.sendCmdEnd();
+    return wrapRange(value / 1000 + steps, 118, 137) * 1000 + value % 1000;
+  }
+  // --- NAV: 50 Khz without carry, 108.00 - 117.95 ---
+  if (channel == kNAV1StandbyFreq || channel == kNAV2StandbyFreq) {
+    if (unit == 0) {
+      return value / 1000 * 1000 + wrapRange(value % 1000 + steps * 50L, 0, 1000);
     }
-    // NAV2 Khz
-    if (freqSelMode == 0 && sysSelect == 4) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV2_RADIO_FRACT_DEC")));
-      messenger.sendCmdEnd();
+    return wrapRange(value / 1000 + steps, 108, 118) * 1000 + value % 1000;
+  }
+  // --- ADF: selected digit with carry, 100.0 - 1799.9 Khz ---
+  if (channel == kADFActiveFreq) {
+    static const uint16_t adfStep[4] PROGMEM = {1, 10, 100, 1000};
+    return wrapRange(value + steps * (long)pgm_read_word(&adfStep[unit]), 1000, 18000);
+  }
+  // --- ADF card: degrees ---
+  if (channel == kADFHDG) {
+    return wrapRange(value + steps, 0, 360);
+  }
+  // --- XPNDR: octal digit without carry ---
+  long scale = 1;
+  for (int i = 0; i < unit; i++) {
+    scale *= 10;
+  }
+  long digit = (value / scale) % 10;
+  return value + (wrapRange(digit + steps, 0, 8) - digit) * scale;
+}
+
+// ------------------------------------------ Prediction ------------------------------------------
+// Apply knob steps to the local copy of the channel and show it. Steps continue from the
+// prediction while it is active, so a fast turn is not reset by older values on their way back.
+void predictSteps(int channel, int coarse, int coarseUnit, int fine, int fineUnit) {
+  if (!predictActive || channel != predictChannel) {
+    predictChannel = channel;
+    predictValue = channelValue(channel);
+    predictActive = true;
+  }
+  predictValue = stepChannel(channel, predictValue, coarse, coarseUnit);
+  predictValue = stepChannel(channel, predictValue, fine, fineUnit);
+  predictMs = millis();
+  renderPanels(channelBit(channel));
+}
+
+// An authoritative value arrived. The same as predicted confirms it, anything else
+// may still be an older value on its way and is left to predictScheduler().
+void reconcilePrediction(int channel, long received) {
+  if (predictActive && channel == predictChannel && received == predictValue) {
+    predictActive = false;
+    predictHits++;
+  }
+}
+
+// Drop a prediction the sim did not confirm in time and show its value instead
+void predictScheduler() {
+  if (!predictActive || setPending || millis() - predictMs < predictHoldMs) {
+    return;
+  }
+  if (channelValue(predictChannel) != predictValue) {
+    predictMisses++;
+  }
+  predictActive = false;
+  renderPanels(channelBit(predictChannel));
+}
+
+// Value to draw for a channel: the prediction while there is one
+long shownValue(int channel, long value) {
+  return predictActive && channel == predictChannel ? predictValue : value;
+}
+
+// Decimal digits to BCD, 4 bits per digit
+unsigned long toBCD(unsigned long v) {
+  unsigned long bcd = 0;
+  for (int shift = 0; v > 0; shift += 4) {
+    bcd |= (v % 10) << shift;
+    v /= 10;
+  }
+  return bcd;
+}
+
+// Send the absolute value of a channel as one SET event
+void sendSetEvent(int channel, long value) {
+  unsigned long arg = value;
+  if (channel == kCOM1StandbyFreq || channel == kCOM2StandbyFreq ||
+      channel == kNAV1StandbyFreq || channel == kNAV2StandbyFreq) {
+    arg = value * 1000;                   // Hz
+  }
+  if (channel == kADFActiveFreq) {
+    arg = toBCD(value * 100);             // BCD Hz
+  }
+  if (channel == kXpndr) {
+    arg = toBCD(value);                   // BCD16 code
+  }
+  uint8_t event = pgm_read_byte(&setEvents[channel - kADFActiveFreq]);
+  // A target still queued for the same channel is out of date
+  serialLink.urgentNext();
+  serialLink.mergeNext();
+  if (aliasesOn) {
+    messenger.sendCmdStart(kAliasCommand);
+    messenger.sendCmdArg(event);
+  } else {
+    messenger.sendCmdStart(kSimCommand);
+    messenger.sendCmdArg(simEventName(event));
+  }
+  messenger.sendCmdArg(arg);
+  messenger.sendCmdEnd();
+}
+
+// Send the pending target now, before anything that depends on it. Returns false while the
+// outbound queue has no room for it, it stays pending then.
+bool flushSetEvent() {
+  if (!setPending) {
+    return true;
+  }
+  if (serialLink.room() < SerialLink::kMaxFrame) {
+    return false;
+  }
+  sendSetEvent(setChannel, setTarget);
+  setPending = false;
+  predictMs = millis();
+  return true;
+}
+
+// Send the target once the knob has been quiet for setSettleMs
+void setScheduler() {
+  if (setPending && millis() - lastSetStepMs >= setSettleMs) {
+    flushSetEvent();
+  }
+}
+
+// ------------------------------------------ Subscriptions ------------------------------------------
+// Data channels shown by the screen of a system (1..6)
+unsigned int screenOf(int system) {
+  return pgm_read_word(&screenChannels[modeLCD ? 1 : 0][system - 1]);
+}
+
+// The current screen plus the next different one in the double click order, so its
+// values are already there when the pilot switches
+template <class Encoder, class Display>
+unsigned int Panel<Encoder, Display>::wanted() const {
+  unsigned int shown = screenOf(sysSelect);
+  unsigned int next = shown;
+  for (int system = sysSelect % 6 + 1; next == shown && system != sysSelect; system = system % 6 + 1) {
+    next = screenOf(system);
+  }
+  return shown | next;
+}
+
+// What any panel wants
+unsigned int wantedChannels() {
+  unsigned int wanted = 0;
+  for (uint8_t i = 0; i < panelCount; i++) {
+    wanted |= panels[i]->wanted();
+  }
+  return wanted;
+}
+
+// A display mode change in config mode would subscribe and unsubscribe on every detent
+bool configuring() {
+  for (uint8_t i = 0; i < panelCount; i++) {
+    if (panels[i]->inConfig()) {
+      return true;
     }
-    // NAV2 Mhz
-    if (freqSelMode == 1 && sysSelect == 4) {
-      messenger.sendCmd(kSimCommand,(F("SIMCONNECT:NAV2_RADIO_WHOLE_DEC")));
-      messenger.sendCmdEnd();
+  }
+  return false;
+}
+
+void sendSubscription(const __FlashStringHelper* command, int channel) {
+  messenger.sendCmdStart(kCommand);
+  messenger.sendCmdArg(command);
+  messenger.sendCmdArg(channel);
+  messenger.sendCmdArg((const __FlashStringHelper*)pgm_read_ptr(&dataPaths[channel - kADFActiveFreq]));
+  messenger.sendCmdEnd();
+}
+
+// Subscribe the channels that became needed and unsubscribe the ones that are not any more,
+// as the outbound queue has room. The rest follows on the next passes.
+// Unsubscribed values stay on screen from the cache, but are no longer used as SET base.
+void subscriptionScheduler() {
+  if (!subscriptionsOn || configuring()) {
+    return;
+  }
+  unsigned int wanted = wantedChannels();
+  if (wanted == subscribedChannels) {
+    return;
+  }
+  for (int channel = kADFActiveFreq; channel <= kIDENT; channel++) {
+    if (serialLink.room() < SerialLink::kMaxFrame) {
+      return;
     }
-    // XPNDR
-    if (sysSelect == 6){
-      // ----  XPNDR code decrease -----
-      // XPNDR position Selector
-      if (decIDENT == 1) {    // First
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_1_DEC")));
-        messenger.sendCmdEnd();        
-      }
-      if (decIDENT == 2) {    // Second
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_10_DEC")));
-        messenger.sendCmdEnd();
-      }
-      if (decIDENT == 3) {    // Third
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_100_DEC")));
-        messenger.sendCmdEnd();
-      }
-      if (decIDENT == 4) {    // Fourth
-        messenger.sendCmd(kSimCommand,(F("SIMCONNECT:XPNDR_1000_DEC")));
-        messenger.sendCmdEnd();        
-      }
+    unsigned int bit = channelBit(channel);
+    if ((wanted & bit) && !(subscribedChannels & bit)) {
+      sendSubscription(F("SUBSCRIBE"), channel);
+      subscribedChannels |= bit;
     }
-    // CONFIG
-    if(configMode == 1) {
-      // (1)=Screen Mode; (2)=Brightness; (3)=Contrast
-      if (configState == 1){
-        modeLCD = !modeLCD;
-        printLCD();
-      }
-      if (configState == 2){
-        iluminacion--;
-        applyConfig();
-        printLCD();
-      }
-      if (configState == 3){
-        contraste--;
-        applyConfig();
-        printLCD();
-      }
+    if (!(wanted & bit) && (subscribedChannels & bit)) {
+      sendSubscription(F("UNSUBSCRIBE"), channel);
+      subscribedChannels &= ~bit;
+      channelsSeen &= ~bit;
     }
   }
 }
@@ -813,31 +1788,35 @@ void onEb1Encoder(EncoderButton& eb) {
 
 void onEvent()
 {
-  char *szRequest = messenger.readStringArg();
+  switch (classifyToken(messenger.readStringArg())) {
 // ------ Begin transmission ------
-  if (strcmp(szRequest, "START") == 0) {
-    lcd.clear();
+  case tkSTART:
+    for (uint8_t i = 0; i < panelCount; i++) {
+      panels[i]->blank();
+    }
     return;
-  }
 // ------- End Transmission --------
-   if (strcmp(szRequest, "END") == 0) {
-    lcd.clear();
+  case tkEND:
+    aliasesOn = false;
+    aliasNext = evNone;
+    configReplyPending = false;
+    com833 = false;
+    predictActive = false;
+    subscriptionsOn = false;
+    subscribedChannels = 0;
+    for (uint8_t i = 0; i < panelCount; i++) {
+      panels[i]->blank();
+    }
     return;
-  }
-  // ------- Provider Event --------
-  if (strcmp(szRequest, "PROVIDER") == 0) {
-    // Aquí manejas el evento PROVIDER
-    // Por ejemplo, puedes leer los argumentos adicionales:
-    String arg1 = messenger.readStringArg();
-    String arg2 = messenger.readStringArg();
-
-    if (arg1 == "MSFS") {
-      if (arg2 == "1") {
-        // MSFS is connected
-        isReady = true;
-      }
+// ------- Provider Event: PROVIDER,MSFS,1 --------
+  case tkPROVIDER:
+    if (classifyToken(messenger.readStringArg()) == tkMSFS && messenger.readInt16Arg() == 1) {
+      // MSFS is connected
+      isReady = true;
     }
     return;
+  default:
+    return;
   }
 }
 
@@ -845,115 +1824,92 @@ void onEvent()
 
 void onUnknownCommand()
 {
-  messenger.sendCmd(kDebug,"UNKNOWN COMMAND"); 
+  serialLink.dropNext();
+  messenger.sendCmd(kDebug,F("UNKNOWN COMMAND")); 
 }
 
 // ------------------------------------- SPAD.neXt Init --------------------------------------
 
 void onIdentifyRequest()
 {
-  char *szRequest = messenger.readStringArg();
-  if (strcmp(szRequest, "INIT") == 0) {
-    messenger.sendCmdStart(kRequest);
-    messenger.sendCmdArg(F("SPAD"));
-    messenger.sendCmdArg(F("{9d6440d1-3d36-4f2c-884d-1d4bc2cde171}"));
-    messenger.sendCmdArg(F("One Knob Radio_FS20 v1.0"));
-    messenger.sendCmdEnd();
+  switch (classifyToken(messenger.readStringArg())) {
+  case tkINIT: {
+    // Hosts that can go faster say so ("0,INIT,BAUD,<rate>;"), SPAD.neXt sends INIT alone
+    unsigned long offered = 0;
+    while (messenger.available()) {
+      Token option = classifyToken(messenger.readStringArg());
+      if (option == tkBAUD) {
+        offered = messenger.readInt32Arg();
+      }
+    }
+    initReplyPending = true;
+    if (offered != 0) {
+      // "0,BAUD,<rate>;" follows, both sides switch once it is on the wire. Without the
+      // framed link (SERIAL_LINK_FRAMING) the answer is always baseBaud.
+      baudReplyRate = baseBaud;
+#if SERIAL_LINK_FRAMING
+      for (uint8_t i = 0; i < sizeof(fastBauds) / sizeof(fastBauds[0]); i++) {
+        unsigned long fast = pgm_read_dword(&fastBauds[i]);
+        if (fast <= offered) {
+          baudReplyRate = fast;
+          break;
+        }
+      }
+#endif
+    }
+    handshakeScheduler();
     return;
   }
 
 // --------------------------------- SPAD.neXt Ping ----------------------------------
 
-  if (strcmp(szRequest, "PING") == 0) {
-    messenger.sendCmdStart(kRequest);
-    messenger.sendCmdArg(F("PONG"));
-    messenger.sendCmdArg(messenger.readInt32Arg());
-    messenger.sendCmdEnd();
+  case tkPING:
+    pongValue = messenger.readInt32Arg();
+    pongPending = true;
+    handshakeScheduler();
     return;
-  }
 
-  // ------------------------------- SPAD.neXt Subscriptions ------------------------------
-
-  if (strcmp(szRequest, "CONFIG") == 0) {
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kADFActiveFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:ADF ACTIVE FREQUENCY:1"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kCOM1ActiveFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:COM ACTIVE FREQUENCY:1"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kCOM1StandbyFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:COM STANDBY FREQUENCY:1"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kNAV1ActiveFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:NAV ACTIVE FREQUENCY:1"));
-    messenger.sendCmdEnd();
+// --------------------------------- Statistics ----------------------------------
 
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kNAV1StandbyFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:NAV STANDBY FREQUENCY:1"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kCOM2ActiveFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:COM ACTIVE FREQUENCY:2"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kCOM2StandbyFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:COM STANDBY FREQUENCY:2"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kNAV2ActiveFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:NAV ACTIVE FREQUENCY:2"));
-    messenger.sendCmdEnd();
-
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kNAV2StandbyFreq);
-    messenger.sendCmdArg(F("SIMCONNECT:NAV STANDBY FREQUENCY:2"));
-    messenger.sendCmdEnd();
+  case tkSTATS:
+    sendStats(kRequest);
+    return;
 
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kADFHDG);
-    messenger.sendCmdArg(F("SIMCONNECT:ADF CARD"));
-    messenger.sendCmdEnd();
+  // ------------------------------- SPAD.neXt Subscriptions ------------------------------
 
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kXpndr);
-    messenger.sendCmdArg(F("SIMCONNECT:TRANSPONDER CODE:1"));
-    messenger.sendCmdEnd();
+  case tkCONFIG: {
+    // Hosts that know the aliases or the binary values say so ("0,CONFIG,ALIAS,BINARY;"),
+    // SPAD.neXt sends CONFIG alone and gets full names
+    bool aliases = false;
+    bool binary = false;
+    while (messenger.available()) {
+      Token option = classifyToken(messenger.readStringArg());
+      if (option == tkALIAS) {
+        aliases = true;
+      } else if (option == tkBINARY) {
+        binary = true;
+      }
+    }
 
-    messenger.sendCmdStart(kCommand);
-    messenger.sendCmdArg(F("SUBSCRIBE"));
-    messenger.sendCmdArg(kIDENT);
-    messenger.sendCmdArg(F("SIMCONNECT:TRANSPONDER IDENT"));
-    messenger.sendCmdEnd();
+    // Only what the screen needs, the rest follows when the screen changes
+    subscribedChannels = 0;
+    subscriptionsOn = true;
+    subscriptionScheduler();
 
     // --- End of Subscriptions ---
-    messenger.sendCmd(kRequest, F("CONFIG"));
-    messenger.sendCmdEnd();
+    aliasesOn = false;
+    aliasNext = aliases ? evNone + 1 : evNone;
+    aliasScheduler();
+    configReplyPending = true;
+    configReplyBinary = binary;
+    configScheduler();
     isReady = true;
     return;
   }
+
+  default:
+    return;
+  }
 }
 
 // --------------- C M D M E S S E N G E R  C A L L B A C K S  D E C L A R A T I O N S ------------
@@ -975,61 +1931,190 @@ void attachCommandCallbacks()
   messenger.attach(kNAV2StandbyFreq, onNAV2StandbyFreq);
   messenger.attach(kXpndr, onXpndr);
   messenger.attach(kIDENT, onIDENT);
+  messenger.attach(kValues, onValues);
 }
 
 
 
+// ------------------------------------ T A S K S --------------------------------------
+
+// Buttons and encoders of every panel, the rotation collected is sent at once
+void knobTask(){
+  for (uint8_t i = 0; i < panelCount; i++) {
+    panels[i]->update();
+  }
+}
+
+// Queued frames to the UART, as much as its buffer takes now. The handshake and STATS
+// replies as they fit.
+void txTask(){
+  handshakeScheduler();
+  statsScheduler();
+  serialLink.service();
+}
+
+// CmdMessenger, one slice of the received bytes. The rest waits in the RX buffer.
+void serialTask(){
+  unsigned long start = micros();
+  unsigned long bytesIn = link.bytesIn;
+  for (uint8_t fed = 0; fed < serialSliceBytes && micros() - start < serialBudgetUs; fed += serialStepBytes) {
+    unsigned long before = link.bytesIn;
+    link.setReadBudget(serialStepBytes);
+    messenger.feedinSerialData();
+    if (link.bytesIn == before) {
+      break;
+    }
+  }
+  if (link.bytesIn != bytesIn) {
+    callbackStats.add(micros() - start);
+  }
+}
+
+void timerTask(){
+  setScheduler();
+  predictScheduler();
+// Follow screen changes with the subscriptions, aliases asked for at CONFIG
+  subscriptionScheduler();
+  aliasScheduler();
+  configScheduler();
+// Serial rate asked for at INIT
+  baudScheduler();
+#if DEBUG_STATS
+  if (millis() - lastStatsMs >= statsInterval) {
+    sendStats(kDebug);
+  }
+#endif
+}
+
+// Redraw one display where something changed, the next one on the next run
+void drawTask(){
+  panels[drawNext]->renderScheduler();
+  drawNext++;
+  if (drawNext == panelCount) {
+    drawNext = 0;
+  }
+}
+
+// Send a few queued bytes to each display
+void lcdTask(){
+  for (uint8_t i = 0; i < panelCount; i++) {
+    panels[i]->service();
+  }
+}
+
+// Deferred save, one EEPROM byte per run while no cell write is in progress
+void eepromTask(){
+  settingsScheduler();
+  settingsStore.service();
+}
+
+const char taskKnob[] PROGMEM = "KNOB";
+const char taskTx[] PROGMEM = "TX";
+const char taskSerial[] PROGMEM = "SERIAL";
+const char taskTimers[] PROGMEM = "TIMERS";
+const char taskDraw[] PROGMEM = "DRAW";
+const char taskLcd[] PROGMEM = "LCD";
+const char taskEeprom[] PROGMEM = "EEPROM";
+
+// By priority, budgets in us
+Task tasks[] = {
+  { taskKnob, knobTask, 500, 0, 0, 0 },
+  { taskTx, txTask, 300, 0, 0, 0 },
+  { taskSerial, serialTask, serialBudgetUs, 0, 0, 0 },
+  { taskTimers, timerTask, 1000, 0, 0, 0 },
+  { taskDraw, drawTask, 2000, 0, 0, 0 },
+  { taskLcd, lcdTask, 500, 0, 0, 0 },
+  { taskEeprom, eepromTask, 200, 0, 0, 0 },
+};
+Scheduler scheduler(tasks, sizeof(tasks) / sizeof(tasks[0]), knobBoundUs);
+
+// TASKS,name,runs,overruns,max of the i-th task for sendStatsSection(). Returns false
+// after the last task, the counters of all tasks are reset for the next window then.
+bool sendTaskStats(uint8_t i){
+  const Task& task = scheduler.task(i);
+  messenger.sendCmdArg(F("TASKS"));
+  messenger.sendCmdArg((const __FlashStringHelper*)task.name);
+  messenger.sendCmdArg(task.runs);
+  messenger.sendCmdArg(task.overruns);
+  messenger.sendCmdArg(task.longest);
+  if (i + 1 < scheduler.size()) {
+    return true;
+  }
+  scheduler.resetStats();
+  return false;
+}
+
 // ----------------------------------- S E T U P ---------------------------------------
 
+template <class Encoder, class Display>
+void Panel<Encoder, Display>::begin() {
+
+// LCD Initialization
+  lcd.begin(16, 2);
+  lcd.cursor();
+
+// Load LCD Custom Characters 
+  lcd.createChar_P(1,customCharC);
+  lcd.createChar_P(2,customChar1);
+  lcd.createChar_P(3,customCharN);
+  lcd.createChar_P(4,customChar2);
+
+// Splash screen
+  fb.clear();
+  fb.setCursor(0,0);
+  fb.print(F("One Knob Radio"));
+  if (ramAtBoot < ramReserve) {
+    fb.setCursor(0,1);
+    fb.print(F("LOW RAM "));
+    fb.print(ramAtBoot);
+  }
+  fb.setCursor(12,1);
+  fb.print(F("v1.0"));
+  lcdSynced = fb.flush(lcd);
+
+// Encoder & button callback initialization
+  knob.begin();
+  button.setUserId(id);
+  button.setLongClickDuration(700);
+  button.setClickHandler(onButtonClicked);
+  button.setLongPressHandler(onButtonLongClick);
+  button.setDoubleClickHandler(onButtonDoubleClick);
+  button.setTripleClickHandler(onButtonTripleClick);
+}
+
 void setup() {
 
+// Stack high-water mark from here, the free RAM left for it
+  paintRam();
+  ramAtBoot = freeRam();
+
 // PWM Brightness control LCD   
   pinMode(luzPin, OUTPUT);
   pinMode(contrastePin, OUTPUT);
-  if (pwmset == true){
-    iluminacion = EEPROM.read(0);
-    contraste = EEPROM.read(1);
-    analogWrite(luzPin, iluminacion);
-    analogWrite(contrastePin, contraste);
-  } else {
-    analogWrite(luzPin, iluminacionDef);
-    analogWrite(contrastePin, contrasteDef);  
-  }
-    
-// LiquidCrystal Initialization
-  lcd.begin(16, 2);
-  lcd.setCursor(0,0);
-  lcd.print(F("One Knob Radio"));
-  lcd.setCursor(12,1);
-  lcd.print(F("v1.0"));
+  loadSettings();
 
-// Load LCD Custom Characters 
-  lcd.createChar(1,customCharC);
-  lcd.createChar(2,customChar1);
-  lcd.createChar(3,customCharN);
-  lcd.createChar(4,customChar2);
+// Displays, knobs and buttons
+  for (uint8_t i = 0; i < panelCount; i++) {
+    panels[i]->begin();
+  }
 
 // Serial Port Initialization
-  Serial.begin(115200);
+  Serial.begin(baseBaud);
 
 // User callback initialization
   attachCommandCallbacks();
 
-// Encoder & button callback initialization
-  eb1.setLongClickDuration(700);
-  eb1.setClickHandler(onEb1Clicked);
-  eb1.setEncoderHandler(onEb1Encoder);
-  eb1.setLongPressHandler(onEb1LongClick);
-  eb1.setDoubleClickHandler(onEb1DoubleClick);
-  eb1.setTripleClickHandler(onEb1TripleClick);
+// First stats window starts here
+  lastStatsMs = millis();
+  lastLoopUs = micros();
 }
 
 // ------------------------------------ L O O P --------------------------------------
 
 void loop() {
-// CmdMessenger start
-  messenger.feedinSerialData();
+  unsigned long loopStart = micros();
+  loopStats.add(loopStart - lastLoopUs);
+  lastLoopUs = loopStart;
 
-// EncoderButton start
-  eb1.update();  
+  scheduler.run();
 }